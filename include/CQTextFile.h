@@ -13,6 +13,8 @@ class CTextFileKey;
 class CTextFileViKey;
 class CTextFileNormalKey;
 class CTextFileEd;
+class CTextFileMatchSet;
+class QTimer;
 
 class CQTextFile : public QWidget, public CTextFileSelNotifier, public CTextFileKeyNotifier {
   Q_OBJECT
@@ -30,6 +32,7 @@ class CQTextFile : public QWidget, public CTextFileSelNotifier, public CTextFile
 
  public:
   CQTextFile(QWidget *parent=NULL);
+ ~CQTextFile();
 
   CQTextFileCanvas *getCanvas () const { return canvas_ ; }
   QScrollBar       *getHScroll() const { return hscroll_; }
@@ -55,6 +58,21 @@ class CQTextFile : public QWidget, public CTextFileSelNotifier, public CTextFile
   void setNumber(bool number);
   bool getNumber() const { return number_; }
 
+  void notifyHlSearch(bool hlsearch);
+
+  void notifyFindPattern(const std::string &pattern);
+
+  void setHlSearch(bool hlsearch);
+  bool getHlSearch() const { return hlsearch_; }
+
+  CTextFileMatchSet *getMatchSet() const { return matchSet_; }
+
+  // merge completed background match and show match count (polled from timer and paint)
+  void updateMatchSet();
+
+  // report finished ed dry run count (polled from timer while it runs)
+  void updateDryRun();
+
   void loadFile(const char *fileName);
 
   void scrollToPos(CScrollType type);
@@ -65,11 +83,18 @@ class CQTextFile : public QWidget, public CTextFileSelNotifier, public CTextFile
   void hscrollSlot();
   void vscrollSlot();
 
+  void matchTimerSlot();
+
+  void dryRunTimerSlot();
+
  signals:
   void textEntered(const QString &text);
 
   void sizeChanged(int, int);
 
+ private:
+  void setMatchPattern(const std::string &pattern);
+
  private:
   CQTextFileCanvas*   canvas_ { nullptr };
   QScrollBar*         hscroll_ { nullptr };
@@ -80,6 +105,11 @@ class CQTextFile : public QWidget, public CTextFileSelNotifier, public CTextFile
   CTextFileNormalKey* normalKey_ { nullptr };
   CTextFileViKey*     viKey_ { nullptr };
   bool                number_ { false };
+  CTextFileMatchSet*  matchSet_ { nullptr };
+  bool                hlsearch_ { false };
+  QTimer*             matchTimer_ { nullptr };
+  int                 numMatches_ { -1 }; // last shown match count
+  QTimer*             dryRunTimer_ { nullptr };
 };
 
 #endif
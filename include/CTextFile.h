@@ -6,12 +6,19 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <memory>
 #include <cassert>
 #include <cstddef>
 #include <cmath>
 #include <sys/types.h>
 
 class CTextFileNotifyMgr;
+class CTextFileTrigramIndex;
+class CTextLine;
+
+// lines are shared (between file, snapshots and undo) and copied on write
+typedef std::shared_ptr<CTextLine> CTextLineP;
+typedef std::vector<CTextLineP>    CTextLineList;
 
 // notifier
 class CTextFileNotifier {
@@ -32,8 +39,15 @@ class CTextFileNotifier {
   virtual void charDeleted (char c, uint line_num, uint char_num);
   virtual void charReplaced(char c1, char c2, uint line_num, uint char_num);
 
+  // lines [line_num, line_num + oldLines.size()) replaced by newLines
+  virtual void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                            const CTextLineList &newLines);
+
   virtual void startGroup();
   virtual void endGroup  ();
+
+  virtual void startNoUndo();
+  virtual void endNoUndo  ();
 };
 
 //------
@@ -233,6 +247,15 @@ struct CTextFileInfo {
 
 //------
 
+// snapshot of line table (line data shared with file)
+struct CTextFileSnapshot {
+  CTextLineList lines;
+  uint          x { 0 };
+  uint          y { 0 };
+};
+
+//------
+
 class CTextLine {
  public:
   CTextLine(const std::string &line) : line_(line) { }
@@ -310,6 +333,20 @@ class CTextFile : public CTextFileIFace {
   void replaceChar(char c) override;
   void replaceLine(const std::string &l) override;
 
+  // bulk edit
+  void spliceLines(uint line_num, uint n, const CTextLineList &lines);
+
+  // lines [line_num, line_num + n) (line data shared with file)
+  CTextLineList getLines(uint line_num, uint n) const;
+
+  // new line for splice
+  CTextLineP createLine(const std::string &str);
+
+  // snapshot
+  CTextFileSnapshot getSnapshot() const;
+
+  void restoreSnapshot(const CTextFileSnapshot &snapshot);
+
   // visual
   uint getPageTop   () const override;
   void setPageTop   (uint pos) override;
@@ -320,6 +357,16 @@ class CTextFile : public CTextFileIFace {
   void startGroup() override;
   void endGroup  () override;
 
+  // region in which edits are not recorded for undo
+  void startNoUndo();
+  void endNoUndo  ();
+
+  bool isNoUndo() const { return noUndoDepth_ > 0; }
+
+  // optional search index (owned by caller)
+  CTextFileTrigramIndex *getSearchIndex() const { return searchIndex_; }
+  void setSearchIndex(CTextFileTrigramIndex *index) { searchIndex_ = index; }
+
   // iteration
   LineIterator beginLine() override;
   LineIterator endLine  () override;
@@ -335,15 +382,32 @@ class CTextFile : public CTextFileIFace {
   virtual CTextLine *allocLine(const std::string &line);
 
  private:
-  typedef std::vector<CTextLine *> LineList;
-
-  CTextFileInfo       fileInfo_;
-  CTextFileCursor     cursor_;
-  LineList            oldLines_;
-  LineList            lines_;
-  int                 pageTop_    { -1 };
-  int                 pageBottom_ { -1 };
-  CTextFileNotifyMgr* notifyMgr_  { nullptr };
+  typedef CTextLineList LineList;
+
+  CTextFileInfo          fileInfo_;
+  CTextFileCursor        cursor_;
+  LineList               lines_;
+  int                    pageTop_     { -1 };
+  int                    pageBottom_  { -1 };
+  uint                   noUndoDepth_ { 0 };
+  CTextFileTrigramIndex* searchIndex_ { nullptr };
+  CTextFileNotifyMgr*    notifyMgr_   { nullptr };
+};
+
+//------
+
+// scoped no undo region (e.g. load, reload or batch edit)
+class CTextFileNoUndo {
+ public:
+  CTextFileNoUndo(CTextFile *file) : file_(file) { file_->startNoUndo(); }
+ ~CTextFileNoUndo() { file_->endNoUndo(); }
+
+ private:
+  CTextFileNoUndo(const CTextFileNoUndo &rhs);
+  CTextFileNoUndo &operator=(const CTextFileNoUndo &rhs);
+
+ private:
+  CTextFile *file_ { nullptr };
 };
 
 //------
@@ -365,10 +429,15 @@ class CTextFileNotifyMgr {
   void notifyCharAdded   (char c, uint line_num, uint char_num);
   void notifyCharDeleted (char c, uint line_num, uint char_num);
   void notifyCharReplaced(char c1, char c, uint line_num, uint char_num);
+  void notifyLinesSpliced(uint line_num, const CTextLineList &oldLines,
+                          const CTextLineList &newLines);
 
   void notifyStartGroup();
   void notifyEndGroup  ();
 
+  void notifyStartNoUndo();
+  void notifyEndNoUndo  ();
+
  private:
   typedef std::list<CTextFileNotifier *> NotifierList;
 
@@ -1,53 +1,56 @@
 #ifndef CTEXT_BUFFER_H
 #define CTEXT_BUFFER_H
 
+#include <CTextFile.h>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
 #include <sys/types.h>
 
-class CTextFile;
 class CTextFileUtil;
 
 // class to store set of named buffers (yanked parts of file)
 class CTextFileBuffer {
  private:
-  struct BufferLine {
-    std::string line;
-    bool        newline { false };
-
-    BufferLine(const std::string &line1, bool newline1) :
-     line(line1), newline(newline1) {
-    }
-
-    const std::string &getLine() const { return line; }
-
-    bool getNewLine() const { return newline; }
-  };
-
+  // lines are shared with the file (the file copies a shared line before changing it)
+  // so a yank only stores a reference to each line
   struct Buffer {
-    typedef std::vector<BufferLine> LineList;
+    CTextLineList     lines;
+    std::vector<bool> newlines;         // line ends with newline (whole line)
+    bool              shared { false }; // stored in shared memory
+    uint64_t          seq    { 0 };     // sequence number of shared contents
 
-    LineList lines;
-
-    Buffer() :
-     lines() {
-    }
+    Buffer() { }
 
     void clear() {
-      lines.clear();
+      lines   .clear();
+      newlines.clear();
+
+      seq = 0;
     }
 
     uint getNumLines() const {
       return uint(lines.size());
     }
 
-    const BufferLine &getLine(uint i) const {
-      return lines[i];
+    const std::string &getLine(uint i) const {
+      return lines[i]->getString();
+    }
+
+    bool getNewLine(uint i) const {
+      return newlines[i];
+    }
+
+    void addLine(const CTextLineP &line, bool newline) {
+      lines   .push_back(line);
+      newlines.push_back(newline);
     }
 
-    void addLine(const std::string &line, bool newline) {
-      lines.push_back(BufferLine(line, newline));
+    void addLines(const CTextLineList &lines1) {
+      lines.insert(lines.end(), lines1.begin(), lines1.end());
+
+      newlines.resize(lines.size(), true);
     }
   };
 
@@ -73,19 +76,27 @@ class CTextFileBuffer {
   void subYankTo(char id, uint line_num1, uint char_num1,
                  uint line_num2, uint char_num2, bool is_line);
 
-  void pasteAfter(char id);
-  void pasteAfter(char id, uint line_num, uint char_num);
-  void pasteBefore(char id);
-  void pasteBefore(char id, uint line_num, uint char_num);
+  // shared buffers (registers + and * by default) are stored in shared memory so
+  // they can be pasted by other instances
+  bool isShared(char id) const;
+  void setShared(char id, bool shared);
 
- private:
-  void cursorToLeft();
+  // error of last failed shared buffer store or load (empty if none)
+  const std::string &getError() const { return error_; }
+  void clearError() { error_ = ""; }
 
-  void splitLine(uint line_num, uint char_num);
+  // paste count copies of buffer (in one splice)
+  void pasteAfter(char id, uint count=1);
+  void pasteAfter(char id, uint line_num, uint char_num, uint count=1);
+  void pasteBefore(char id, uint count=1);
+  void pasteBefore(char id, uint line_num, uint char_num, uint count=1);
 
-  void addChars(uint line_num, uint char_num, const std::string &chars);
+ private:
+  void paste(char id, uint line_num, uint char_num, uint count, bool after);
 
-  void addLine(uint line_num, const std::string &line);
+  // write shared buffer to, or update from, shared memory
+  void storeShared(char id);
+  void loadShared (char id);
 
   Buffer &getBuffer(char id);
 
@@ -95,6 +106,7 @@ class CTextFileBuffer {
   CTextFile     *file_ { nullptr };
   CTextFileUtil *util_ { nullptr };
   BufferMap      buffer_map_;
+  std::string    error_;
 };
 
 #endif
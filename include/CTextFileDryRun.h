@@ -0,0 +1,66 @@
+#ifndef CTEXT_FILE_DRY_RUN_H
+#define CTEXT_FILE_DRY_RUN_H
+
+#include <CTextFileSearch.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+class CTextFile;
+class CTextFileUtil;
+
+// Dry run of a substitute (:s) or global (:g/:v) command on a range of lines.
+//
+// Counts the lines and matches the command would affect, and keeps the first few
+// affected lines, without changing the file or its undo. The count is made in a
+// background thread from a snapshot of the lines, so the file can still be edited
+// while it runs (the result is for the lines when it was started).
+class CTextFileDryRun {
+ public:
+  typedef CTextFileSearch::Count Count;
+
+ public:
+  CTextFileDryRun(CTextFile *file);
+ ~CTextFileDryRun();
+
+  // start count of substitute of find by replace in lines [line_num1, line_num2]
+  void startSubst(uint line_num1, uint line_num2, const std::string &find,
+                  const std::string &replace, bool global, bool caseSensitive,
+                  uint maxLines=0);
+
+  // start count of lines in [line_num1, line_num2] matching find (not matching if invert)
+  void startGlob(uint line_num1, uint line_num2, const std::string &find,
+                 bool invert, bool caseSensitive, uint maxLines=0);
+
+  // count finished (or cancelled)
+  bool isDone() const { return done_; }
+
+  bool isCancelled() const { return cancelled_; }
+
+  // result (waits for count to finish)
+  const Count &getCount();
+
+  void cancel();
+
+ private:
+  CTextFileDryRun(const CTextFileDryRun &rhs);
+  CTextFileDryRun &operator=(const CTextFileDryRun &rhs);
+
+  typedef std::function<bool (const CTextFileSearch &, uint, uint, Count &)> CountProc;
+
+  void start(uint line_num1, uint line_num2, const CountProc &proc);
+
+  void wait();
+
+ private:
+  CTextFile*        file_      { nullptr };
+  CTextFileUtil*    util_      { nullptr };
+  CTextLineList     lines_;
+  std::thread       thread_;
+  std::atomic<bool> done_      { true };
+  std::atomic<bool> cancel_    { false };
+  std::atomic<bool> cancelled_ { false };
+  Count             count_;
+};
+
+#endif
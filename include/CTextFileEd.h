@@ -4,6 +4,7 @@
 #include <CRegExp.h>
 #include <CIPoint2D.h>
 #include <list>
+#include <functional>
 #include <sys/types.h>
 
 class CReadLine;
@@ -13,6 +14,11 @@ class CTextFileUtil;
 class CTextFileMarks;
 class CTextFileUndo;
 class CStrParse;
+class CTextFileSubst;
+class CTextFileDryRun;
+
+struct CTextFileEdAddr;
+struct CTextFileEdCmd;
 
 class CTextFileEdNotifierMgr;
 
@@ -23,6 +29,16 @@ class CTextFileEdNotifier {
   virtual ~CTextFileEdNotifier() { }
 
   virtual void edNotifyQuit(bool force);
+
+  // progress of filter (!) command (lines written, total lines), return false to cancel
+  virtual bool edNotifyFilterProgress(uint numLines, uint totalLines);
+
+  // output block of lines (each ending in a newline), return true if handled
+  virtual bool edNotifyOutput(const std::string &text);
+
+  // finished dry run count of substitute (matches on lines) or global (lines) with
+  // message for it, return true if handled
+  virtual bool edNotifyCount(uint numMatches, uint numLines, const std::string &msg);
 };
 
 class CEdPointCondition {
@@ -115,9 +131,15 @@ class CTextFileEd {
 
   bool execCmd(const std::string &cmd);
 
+  // run pre-parsed command (see CTextFileEdScript)
+  bool execCmd(const CTextFileEdCmd &cmd);
+
   bool findNext(const std::string &str, int *line_num, int *char_num);
   bool findPrev(const std::string &str, int *line_num, int *char_num);
 
+  bool findNext(const CRegExp &regexp, int *line_num, int *char_num);
+  bool findPrev(const CRegExp &regexp, int *line_num, int *char_num);
+
   Mode getMode() const { return mode_; }
 
   bool isQuit() const { return quit_; }
@@ -133,11 +155,30 @@ class CTextFileEd {
   void doSubstitute(int i1, int i2, const std::string &find,
                     const std::string &replace, char mod);
 
+  void doSubstitute(int i1, int i2, const CTextFileSubst &subst);
+
+  // count substitutions without changing lines (dry run). The count is made in the
+  // background and reported by edNotifyCount (or output) when finished (see pollDryRun)
+  void doSubstituteCount(int i1, int i2, const std::string &find,
+                         const std::string &replace, char mod);
+
+  // count lines global (:g/<regexp>/count) would run on (dry run, as doSubstituteCount)
+  void doGlobCount(int i1, int i2, const std::string &find, bool invert=false);
+
+  // dry run count not yet reported
+  bool isDryRunPending() const;
+
+  // report dry run count if finished (or wait for it). Returns false if still running
+  bool pollDryRun(bool wait=false);
+
   void doFindNext(int i1, int i2, const std::string &find);
 
   void doFindPrev(int i1, int i2, const std::string &find);
 
-  void doGlob(int i1, int i2, const std::string &find, const std::string &cmd);
+  void doGlob(int i1, int i2, const std::string &find, const std::string &cmd,
+              bool invert=false);
+
+  void doGlob(int i1, int i2, const CRegExp &regexp, bool invert, const CTextFileEdCmd &cmd);
 
   void doJoin(int i1, int i2);
 
@@ -157,11 +198,22 @@ class CTextFileEd {
 
   void doExecute(int i1, int i2, const std::string &cmdStr);
 
+  // sort lines (opts n - numeric, u - unique, r - reverse, i - ignore case) on text
+  // after pattern match
+  void doSort(int i1, int i2, const std::string &opts, const std::string &pattern);
+
+  // delete lines equal to previous line (adjacent) or any earlier line in range
+  void doUniq(int i1, int i2, bool adjacent);
+
   void doPrint(int i1, int i2, bool numbered, bool eol);
 
+  // output single line
   virtual void output(const std::string &msg);
   virtual void error (const std::string &msg);
 
+  // output block of lines (each ending in a newline), sent to notifiers or stdout
+  virtual void outputLines(const std::string &text);
+
   void addLine(uint row, const std::string &str);
 
   void deleteLine(uint row);
@@ -175,9 +227,44 @@ class CTextFileEd {
 
   void edNotifyQuit(bool force);
 
+  bool edNotifyFilterProgress(uint numLines, uint totalLines);
+
+  bool edNotifyOutput(const std::string &text);
+
+  bool edNotifyCount(uint numMatches, uint numLines, const std::string &msg);
+
+  // parse line range (addresses) and single line address
+  static bool parseRange(CStrParse &parse, bool ex, std::vector<CTextFileEdAddr> &addrs,
+                         std::string &msg);
+  static bool parseAddr(CStrParse &parse, bool ex, CTextFileEdAddr &addr, std::string &msg);
+
+  // is command the named command (e.g. sort, not s followed by a separator)
+  static bool isNamedCmd(const std::string &cmd, const std::string &name);
+
  private:
   bool parseCmd(CStrParse &parse);
-  bool parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all);
+
+  // skip rest of named command which has no arguments (error if any)
+  bool parseNamedCmdEnd(CStrParse &parse, const std::string &name);
+
+  // default to whole file if no range given (error in global)
+  bool setWholeFileRange(const std::string &name);
+
+  bool evalRange(const std::vector<CTextFileEdAddr> &addrs);
+  bool evalAddr(const CTextFileEdAddr &addr, int &line_num, int &char_num, bool &all);
+
+  // add line (0 based) to output buffer (flushed when large)
+  void printLine(uint line_num, bool numbered, bool eol);
+
+  void flushOutput();
+
+  // search from line_num1/char_num1 to line_num2/char_num2 (0 based) for match
+  typedef std::function<bool (uint line_num1, int char_num1, int line_num2, int char_num2,
+                              uint *fline_num, uint *fchar_num)> FindProc;
+
+  // find next/prev match from current position (wrapping) using find proc
+  bool findNextProc(const FindProc &proc, int *line_num, int *char_num);
+  bool findPrevProc(const FindProc &proc, int *line_num, int *char_num);
 
  private:
   CTextFileMarks *getMarks() const { return (alt_marks_ ? alt_marks_ : marks_); }
@@ -203,9 +290,14 @@ class CTextFileEd {
   int                      num_lines_;
   InputData                input_data_;
   std::string              findPattern_;
+  std::string              outputBuffer_; // printed lines (reused)
   bool                     ex_; // vi/ex mode
   bool                     case_sensitive_; // vi/ex mode
+  bool                     glob_; // running global command
   bool                     quit_;
+  CTextFileDryRun *        dryRun_;
+  bool                     dryRunPending_; // dry run count not reported
+  bool                     dryRunSubst_;   // dry run is substitute (else global)
 };
 
 class CTextFileEdNotifierMgr {
@@ -219,6 +311,12 @@ class CTextFileEdNotifierMgr {
 
   void edNotifyQuit(bool force);
 
+  bool edNotifyFilterProgress(uint numLines, uint totalLines);
+
+  bool edNotifyOutput(const std::string &text);
+
+  bool edNotifyCount(uint numMatches, uint numLines, const std::string &msg);
+
  private:
   typedef std::list<CTextFileEdNotifier *> NotifierList;
 
@@ -0,0 +1,105 @@
+#ifndef CTEXT_FILE_ED_SCRIPT_H
+#define CTEXT_FILE_ED_SCRIPT_H
+
+#include <CTextFileRegExpCache.h>
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CTextFileEd;
+class CTextFileSubst;
+
+// pre-parsed line address (evaluated against the file when the command is run)
+struct CTextFileEdAddr {
+  enum class Type {
+    LINE,      // <n>
+    CURRENT,   // . (or + and - offsets)
+    LAST,      // $
+    MARK,      // '<c>
+    ALL,       // %
+    FIND_NEXT, // /<regexp>/
+    FIND_PREV  // ?<regexp>?
+  };
+
+  Type        type   { Type::CURRENT };
+  int         line   { 0 };    // line number (LINE)
+  int         offset { 0 };    // +/- offset
+  char        mark   { '\0' }; // mark char (MARK)
+  std::string pattern;         // search pattern (FIND_NEXT, FIND_PREV)
+  CRegExpP    regexp;          // compiled search pattern (optional)
+  char        sep    { '\0' }; // following separator (',' or ';')
+};
+
+typedef std::vector<CTextFileEdAddr> CTextFileEdAddrs;
+
+struct CTextFileEdCmd;
+
+typedef std::shared_ptr<CTextFileEdCmd> CTextFileEdCmdP;
+
+// pre-parsed command line. The range is always parsed, substitute and global
+// commands also have their patterns compiled, other commands are parsed from the
+// body when run
+struct CTextFileEdCmd {
+  std::string                     line;             // command text
+  bool                            text   { false }; // input mode text line
+  CTextFileEdAddrs                addrs;            // range
+  std::string                     body;             // command after range
+  std::shared_ptr<CTextFileSubst> subst;            // s/<regexp>/<replace>/[g]
+  CRegExpP                        regexp;           // g/<regexp>/ or v/<regexp>/
+  bool                            invert { false }; // v or g!
+  CTextFileEdCmdP                 cmd;              // command for g or v
+};
+
+// Compiled ed script (for batch runs of CTextFileEd::execFile).
+//
+// The script is read, split into commands and compiled once, so running it on many
+// files does no parsing or regexp compilation per file. As a CRegExp stores its last
+// match a script must only be run by one thread at a time, copies do not share any
+// compiled state so use a copy of the script in each thread.
+class CTextFileEdScript {
+ public:
+  typedef std::vector<CTextFileEdCmdP> Cmds;
+
+ public:
+  CTextFileEdScript(bool caseSensitive=true);
+
+  CTextFileEdScript(const CTextFileEdScript &script);
+
+  CTextFileEdScript &operator=(const CTextFileEdScript &script);
+
+  bool isCaseSensitive() const { return caseSensitive_; }
+
+  bool getEx() const { return ex_; }
+  void setEx(bool ex) { ex_ = ex; }
+
+  const std::string &getError() const { return error_; }
+
+  const Cmds &getCmds() const { return cmds_; }
+
+  // compile script lines from file (empty and # lines are skipped)
+  bool compileFile(const std::string &fileName);
+
+  // compile script lines
+  bool compile(const std::vector<std::string> &lines);
+
+  // run all commands (false if any command failed)
+  bool exec(CTextFileEd *ed) const;
+
+  // compile single command line (not input mode text)
+  static bool compileCmd(const std::string &line, bool caseSensitive, bool ex,
+                         CTextFileEdCmd &cmd, std::string &msg);
+
+ private:
+  static CTextFileEdCmdP copyCmd(const CTextFileEdCmd &cmd);
+
+  static CRegExpP compileRegExp(const std::string &pattern, bool caseSensitive);
+
+ private:
+  bool        caseSensitive_ { true };
+  bool        ex_            { false };
+  Cmds        cmds_;
+  std::string error_;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CTEXT_FILE_FILTER_H
+#define CTEXT_FILE_FILTER_H
+
+#include <CTextFile.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+
+// Filter lines through a shell command (ed !<command>).
+//
+// The command is run with pipes for its input and output. Lines are written to the
+// command in chunks while its output is read as it arrives (both pipes are polled),
+// so a command writing a lot of output before reading all of its input cannot block,
+// and output is split directly into new lines. The lines are only replaced (in one
+// splice) when the command succeeds, and the progress callback is called regularly
+// so the caller can show progress and cancel the command.
+class CTextFileFilter {
+ public:
+  // progress (lines written, total lines), return false to cancel
+  typedef std::function<bool (uint, uint)> ProgressProc;
+
+ public:
+  CTextFileFilter(CTextFile *file);
+
+  void setProgressProc(const ProgressProc &proc) { progressProc_ = proc; }
+
+  // bytes written to or read from command at a time
+  uint getChunkSize() const { return chunkSize_; }
+  void setChunkSize(uint n) { chunkSize_ = std::max(n, 1U); }
+
+  // filter lines [line_num1, line_num2] through command and replace them by its output
+  // (false if command could not be run, failed or was cancelled)
+  bool filter(uint line_num1, uint line_num2, const std::string &cmd);
+
+  bool isCancelled() const { return cancelled_; }
+
+  // command exit status
+  int getStatus() const { return status_; }
+
+  const std::string &getError() const { return error_; }
+
+ private:
+  CTextFileFilter(const CTextFileFilter &rhs);
+  CTextFileFilter &operator=(const CTextFileFilter &rhs);
+
+  bool run(const std::string &cmd, const CTextLineList &lines, CTextLineList &newLines);
+
+  void addOutput(const char *data, uint len, CTextLineList &newLines);
+
+ private:
+  CTextFile*   file_      { nullptr };
+  ProgressProc progressProc_;
+  uint         chunkSize_ { 65536 };
+  bool         cancelled_ { false };
+  int          status_    { 0 };
+  std::string  error_;
+  std::string  partial_; // output after last newline
+};
+
+#endif
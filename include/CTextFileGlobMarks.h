@@ -0,0 +1,51 @@
+#ifndef CTEXT_FILE_GLOB_MARKS_H
+#define CTEXT_FILE_GLOB_MARKS_H
+
+#include <CTextFile.h>
+#include <vector>
+
+// Lines marked by a global (:g/:v) command.
+//
+// Marks stay on their lines through the edits made by the commands run on them (a
+// deleted line loses its mark, and spliced lines are followed by identity). Marks are
+// visited in line order and an edit before the next mark shifts all the remaining
+// marks by one shared offset, so a command which edits its own line costs O(1) per
+// edit. An edit after the last mark changes nothing (O(1)) and other edits update each
+// remaining mark.
+class CTextFileGlobMarks : public CTextFileNotifier {
+ public:
+  typedef std::vector<uint> LineNums;
+
+ public:
+  CTextFileGlobMarks(CTextFile *file, const LineNums &lines);
+ ~CTextFileGlobMarks();
+
+  // get line of next remaining mark (false if none)
+  bool nextMark(uint *line_num);
+
+  // notifier
+  void fileOpened(const std::string &fileName) override;
+
+  void lineAdded  (const std::string &line, uint line_num) override;
+  void lineDeleted(const std::string &line, uint line_num) override;
+
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines) override;
+
+ private:
+  CTextFileGlobMarks(const CTextFileGlobMarks &rhs);
+  CTextFileGlobMarks &operator=(const CTextFileGlobMarks &rhs);
+
+  void shiftMarks(uint line_num, uint n, uint count,
+                  const CTextLineList *oldLines, const CTextLineList *newLines);
+
+ private:
+  typedef std::vector<int> Lines;
+
+  CTextFile *file_   { nullptr };
+  Lines      lines_;            // mark lines (less offset)
+  uint       pos_    { 0 };     // next mark
+  int        offset_ { 0 };
+};
+
+#endif
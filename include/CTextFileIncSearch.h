@@ -0,0 +1,122 @@
+#ifndef CTEXT_FILE_INC_SEARCH_H
+#define CTEXT_FILE_INC_SEARCH_H
+
+#include <CTextFile.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Incremental (as you type) literal search session.
+//
+// For each pattern typed the set of lines containing it is computed in a background
+// thread. As extending a pattern can only remove lines, the scan for a pattern only
+// filters the lines of its longest already known prefix. A running scan is not
+// cancelled when the pattern is extended: when it finishes it goes on to filter its
+// result for the latest pattern, so fast typing still builds the sets. Sets are kept
+// for prefixes of the current pattern so deleting chars reuses them. Any edit to the
+// file discards all sets.
+//
+// Setting a pattern never scans the whole file: it checks a limited number of lines
+// (of the known prefix set) nearest the start position and if that finds no match the
+// result is pending until the set for the pattern is built (see poll).
+class CTextFileIncSearch : public CTextFileNotifier {
+ public:
+  CTextFileIncSearch(CTextFile *file);
+ ~CTextFileIncSearch();
+
+  bool isActive() const { return active_; }
+
+  bool isForward() const { return forward_; }
+
+  uint getStartLine() const { return startLine_; }
+  uint getStartChar() const { return startChar_; }
+
+  const std::string &getPattern() const { return pattern_; }
+
+  // start session searching from position
+  void start(uint line_num, uint char_num, bool forward, bool caseSensitive=true);
+
+  // end session
+  void end();
+
+  // set pattern and get nearest match from start position (false if none or pending)
+  bool setPattern(const std::string &pattern, uint *line_num, uint *char_num);
+
+  // true if match for pattern is not yet known (waiting for scan)
+  bool isPending() const { return pending_; }
+
+  // get match for pending pattern if its scan has finished (false if none or pending)
+  bool poll(uint *line_num, uint *char_num);
+
+  // notifier
+  void lineAdded   (const std::string &line, uint line_num) override;
+  void lineDeleted (const std::string &line, uint line_num) override;
+  void lineReplaced(const std::string &line1, const std::string &line2, uint line_num) override;
+
+  void charAdded   (char c, uint line_num, uint char_num) override;
+  void charDeleted (char c, uint line_num, uint char_num) override;
+  void charReplaced(char c1, char c2, uint line_num, uint char_num) override;
+
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines) override;
+
+ private:
+  CTextFileIncSearch(const CTextFileIncSearch &rhs);
+  CTextFileIncSearch &operator=(const CTextFileIncSearch &rhs);
+
+  typedef std::vector<uint> LineNums;
+
+  // lines containing pattern
+  struct Candidates {
+    std::string pattern;
+    LineNums    lines;
+  };
+
+  typedef std::shared_ptr<Candidates>          CandidatesP;
+  typedef std::map<std::string,CandidatesP>    CandidatesMap;
+
+  CandidatesP findParent(const std::string &pattern) const;
+
+  // find nearest match checking at most maxLines lines (0 for no limit) of parent
+  // (all lines if none). Returns 1 for match, 0 for none and -1 if limit reached
+  int findMatch(const CandidatesP &parent, uint maxLines, uint *line_num, uint *char_num) const;
+
+  bool findLineMatch(uint line_num, int char_num1, int char_num2, uint *char_num) const;
+
+  void startScan(const CandidatesP &parent);
+
+  // filter parent lines (all if none) for pattern (null if cancelled)
+  CandidatesP scanLines(const CandidatesP &parent, const std::string &pattern, uint gen) const;
+
+  void cancelScan();
+
+  void addScanResults();
+
+  void invalidate();
+
+ private:
+  typedef std::vector<CandidatesP> CandidatesList;
+
+  CTextFile*         file_          { nullptr };
+  bool               active_        { false };
+  bool               forward_       { true };
+  bool               caseSensitive_ { true };
+  uint               startLine_     { 0 };
+  uint               startChar_     { 0 };
+  std::string        pattern_;
+  bool               pending_       { false };
+  CandidatesMap      candidates_;
+  CTextLineList      lines_;
+  std::thread        scanThread_;
+  std::string        scanBase_;                 // pattern of set scan started from
+  std::atomic<uint>  generation_    { 0 };
+  std::atomic<bool>  scanning_      { false };
+  mutable std::mutex mutex_;
+  std::string        scanPattern_;              // latest pattern for scan (locked)
+  CandidatesList     scanResults_;              // finished sets (locked)
+};
+
+#endif
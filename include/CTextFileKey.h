@@ -5,6 +5,7 @@ class CTextFile;
 class CTextFileSel;
 class CTextFileUtil;
 class CTextFileUndo;
+class CTextFileIncSearch;
 
 #include <CKeyType.h>
 #include <CEvent.h>
@@ -32,7 +33,15 @@ class CTextFileKeyNotifier {
 
   virtual void notifyNumber(bool);
 
+  virtual void notifyHlSearch(bool);
+
+  virtual void notifyFindPattern(const std::string &pattern);
+
   virtual void notifyQuit();
+
+  // show progress of long operation (done when value reaches maxValue), process
+  // pending events and return false if cancelled
+  virtual bool notifyProgress(const std::string &msg, uint value, uint maxValue);
 };
 
 //---
@@ -81,8 +90,24 @@ class CTextFileKey {
 
   void notifyNumber(bool);
 
+  void notifyHlSearch(bool);
+
+  void notifyFindPattern(const std::string &pattern);
+
   void notifyQuit();
 
+  bool notifyProgress(const std::string &msg, uint value, uint maxValue);
+
+  const std::string &getFindPattern() const { return findPattern_; }
+
+  // case sensitivity of find next/prev
+  bool isCaseSensitive() const { return caseSensitive_; }
+  void setCaseSensitive(bool b) { caseSensitive_ = b; }
+
+  // find next/prev patterns are regexps (else literal strings)
+  bool isFindRegExp() const { return findRegExp_; }
+  void setFindRegExp(bool b) { findRegExp_ = b; }
+
   void extendSelectLeft (int n=1);
   void extendSelectRight(int n=1);
   void extendSelectUp   (int n=1);
@@ -94,6 +119,21 @@ class CTextFileKey {
   bool findPrev();
   bool findPrev(const std::string &pattern);
 
+  // incremental search (cursor moved to match as pattern is typed). A pattern which is
+  // not literal when find patterns are regexps is not searched, and endIncSearch
+  // returns false so the caller does the find next/prev from the start position
+  void startIncSearch(bool forward);
+  bool updateIncSearch(const std::string &pattern);
+  bool endIncSearch(bool accept);
+
+  bool isIncSearch() const;
+
+  // match for incremental search pattern waiting for background scan
+  bool isIncSearchPending() const;
+
+  // move to pending match if scan has finished (poll while pending)
+  bool pollIncSearch();
+
  protected:
   CTextFile               *file_ { nullptr };
   CTextFileUndo           *undo_ { nullptr };
@@ -103,6 +143,10 @@ class CTextFileKey {
   uint                     tab_stop_ { 8 };
   CTextFileKeyNotifierMgr *notifyMgr_ { nullptr };
   std::string              findPattern_;
+  bool                     caseSensitive_ { true };
+  bool                     findRegExp_ { false };
+  CTextFileIncSearch      *incSearch_ { nullptr };
+  bool                     incMatch_ { false };
 };
 
 //---
@@ -130,8 +174,14 @@ class CTextFileKeyNotifierMgr {
 
   void notifyNumber(bool number);
 
+  void notifyHlSearch(bool hlsearch);
+
+  void notifyFindPattern(const std::string &pattern);
+
   void notifyQuit();
 
+  bool notifyProgress(const std::string &msg, uint value, uint maxValue);
+
  private:
   typedef std::list<CTextFileKeyNotifier *> NotifierList;
 
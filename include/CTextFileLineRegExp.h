@@ -0,0 +1,62 @@
+#ifndef CTEXT_FILE_LINE_REG_EXP_H
+#define CTEXT_FILE_LINE_REG_EXP_H
+
+#include <regex.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// Regular expression (basic syntax, as CRegExp) matched in place at any offset of a
+// line.
+//
+// CRegExp has no offset entry point, so finding the matches after the first needs a
+// copy of the rest of the line, which makes iterating the matches of a long line
+// quadratic and loses the chars before the offset. This uses POSIX regexec with
+// REG_STARTEND on the whole line, so nothing is copied and ^, \< and \b see the chars
+// before the offset. A compiled expression stores its last match so must only be used
+// by one thread at a time (a copy recompiles the pattern).
+class CTextFileLineRegExp {
+ public:
+  CTextFileLineRegExp(const std::string &pattern, bool caseSensitive=true);
+
+  CTextFileLineRegExp(const CTextFileLineRegExp &regexp);
+
+ ~CTextFileLineRegExp();
+
+  const std::string &getPattern() const { return pattern_; }
+
+  bool getCaseSensitive() const { return caseSensitive_; }
+
+  bool isValid() const { return valid_; }
+
+  // find first match in line starting at or after pos
+  bool find(const std::string &line, uint pos=0) const;
+
+  // range of last match [spos, epos] (epos is spos - 1 for an empty match)
+  bool getMatchRange(int *spos, int *epos) const;
+
+  int getNumSubMatches() const;
+
+  // range of sub match i (0 for first) of last match
+  bool getSubMatchRange(int i, int *spos, int *epos) const;
+
+ private:
+  CTextFileLineRegExp &operator=(const CTextFileLineRegExp &rhs);
+
+  void compile();
+
+ private:
+  typedef std::vector<regmatch_t> Matches;
+
+  std::string     pattern_;
+  bool            caseSensitive_ { true };
+  bool            valid_         { false };
+  regex_t         regex_;
+  mutable Matches matches_;                 // whole match then sub matches
+  mutable bool    matched_       { false };
+};
+
+typedef std::shared_ptr<CTextFileLineRegExp> CTextFileLineRegExpP;
+
+#endif
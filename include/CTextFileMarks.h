@@ -1,25 +1,32 @@
 #ifndef CTEXT_MARKS_H
 #define CTEXT_MARKS_H
 
-class CTextFile;
-
+#include <CTextFile.h>
 #include <CIPoint2D.h>
 #include <string>
+#include <vector>
 #include <map>
 #include <sys/types.h>
 
-class CTextFileMarks {
+// Named marks (and the return mark "") anchored to lines.
+//
+// Marks follow their lines through the file's notifier events: edits above a mark
+// move it, a deleted line loses its marks and spliced lines are followed by identity.
+// Marks are kept in line order with a Fenwick tree of line offsets, so an edit shifts
+// all the marks after it with one tree update (found by a binary search) and costs
+// O(log^2 marks) rather than O(marks). Only the marks on the edited lines are visited.
+class CTextFileMarks : public CTextFileNotifier {
  public:
   typedef std::map<std::string,CIPoint2D> MarkList;
 
  public:
-  CTextFileMarks(CTextFile *file) :
-   file_(file) {
-  }
+  CTextFileMarks(CTextFile *file);
+ ~CTextFileMarks();
 
-  uint getNumMarks() const { return uint(marks_.size()); }
+  uint getNumMarks() const { return uint(markInd_.size()); }
 
-  const MarkList &getMarks() const { return marks_; }
+  // current mark positions
+  MarkList getMarks() const;
 
   void markReturn();
 
@@ -31,9 +38,51 @@ class CTextFileMarks {
 
   void displayMarks();
 
+  // notifier
+  void fileOpened(const std::string &fileName) override;
+
+  void lineAdded  (const std::string &line, uint line_num) override;
+  void lineDeleted(const std::string &line, uint line_num) override;
+
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines) override;
+
+ private:
+  CTextFileMarks(const CTextFileMarks &rhs);
+  CTextFileMarks &operator=(const CTextFileMarks &rhs);
+
+  struct Anchor {
+    std::string name;
+    int         line     { 0 };    // line less offset
+    int         char_num { 0 };
+    bool        valid    { true };
+  };
+
+  typedef std::vector<Anchor>        Anchors;
+  typedef std::vector<int>           Offsets;
+  typedef std::map<std::string,uint> MarkInd;
+
+  int anchorLine(uint i) const;
+
+  // index of first anchor on or after line_num
+  uint lowerAnchor(int line_num) const;
+
+  void addOffset(uint i, int d);
+
+  void invalidateAnchor(uint i, int line_num);
+
+  void shiftMarks(uint line_num, uint n, uint count,
+                  const CTextLineList *oldLines, const CTextLineList *newLines);
+
+  // resort anchors by line (dropping invalid) and reset offsets
+  void rebuild();
+
  private:
-  CTextFile *file_ { nullptr };
-  MarkList   marks_;
+  CTextFile *file_       { nullptr };
+  Anchors    anchors_;                // in line order
+  Offsets    offsets_;                // Fenwick tree of line offsets (1 based)
+  MarkInd    markInd_;                // valid mark name to anchor index
+  uint       numInvalid_ { 0 };
 };
 
 #endif
@@ -0,0 +1,135 @@
+#ifndef CTEXT_FILE_MATCH_SET_H
+#define CTEXT_FILE_MATCH_SET_H
+
+#include <CTextFile.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Set of all matches of a pattern in a file (for highlighting all matches).
+//
+// Match spans are cached per line and kept current through notifier events (changed
+// lines are re-matched). Rows are matched on demand (the visible rows first) and the
+// whole file is matched in a background thread from a snapshot of the lines, after
+// which the total match count is known. Edits made while matching in the background
+// are logged and replayed on the result.
+class CTextFileMatchSet : public CTextFileNotifier {
+ public:
+  // matched chars [start, end]
+  struct Span {
+    uint start { 0 };
+    uint end   { 0 };
+
+    Span(uint start1=0, uint end1=0) : start(start1), end(end1) { }
+  };
+
+  typedef std::vector<Span> Spans;
+
+ public:
+  CTextFileMatchSet(CTextFile *file);
+ ~CTextFileMatchSet();
+
+  CTextFile *getFile() const { return file_; }
+
+  const std::string &getPattern() const { return pattern_; }
+
+  bool isRegExp() const { return regexp_; }
+
+  bool isCaseSensitive() const { return caseSensitive_; }
+
+  // set pattern (empty for none) and start matching
+  void setPattern(const std::string &pattern, bool regexp=true, bool caseSensitive=true);
+
+  void clear();
+
+  // match any unmatched rows in range (visible rows)
+  void updateRows(uint row1, uint row2);
+
+  // matches for row (matched if needed)
+  const Spans &getLineSpans(uint row);
+
+  // total number of matches (-1 if whole file not yet matched)
+  int getNumMatches();
+
+  // true if whole file matched (merges completed background match)
+  bool isComplete();
+
+  // notifier
+  void fileOpened(const std::string &fileName) override;
+
+  void lineAdded   (const std::string &line, uint line_num) override;
+  void lineDeleted (const std::string &line, uint line_num) override;
+  void lineReplaced(const std::string &line1, const std::string &line2, uint line_num) override;
+
+  void charAdded   (char c, uint line_num, uint char_num) override;
+  void charDeleted (char c, uint line_num, uint char_num) override;
+  void charReplaced(char c1, char c2, uint line_num, uint char_num) override;
+
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines) override;
+
+  void startNoUndo() override;
+  void endNoUndo  () override;
+
+ public:
+  class Matcher;
+
+  typedef std::shared_ptr<Matcher> MatcherP;
+
+ private:
+  CTextFileMatchSet(const CTextFileMatchSet &rhs);
+  CTextFileMatchSet &operator=(const CTextFileMatchSet &rhs);
+
+  struct LineData {
+    bool  matched { false };
+    Spans spans;
+  };
+
+  typedef std::vector<LineData> Lines;
+
+  // edit applied to lines (replace n lines at line_num by count unmatched lines)
+  struct Edit {
+    uint line_num { 0 };
+    uint n        { 0 };
+    uint count    { 0 };
+  };
+
+  typedef std::vector<Edit> Edits;
+
+  void rebuild();
+
+  void cancelBuild();
+
+  void matchLine(uint line_num);
+
+  void addEdit(uint line_num, uint n, uint count);
+
+  void lineChanged(uint line_num);
+
+ private:
+  enum class State {
+    NONE,
+    BUILDING,
+    COMPLETE
+  };
+
+  CTextFile*        file_          { nullptr };
+  std::string       pattern_;
+  bool              regexp_        { true };
+  bool              caseSensitive_ { true };
+  MatcherP          matcher_;
+  State             state_         { State::NONE };
+  Lines             lines_;
+  uint              numMatches_    { 0 };
+  Lines             buildLines_;
+  Edits             buildEdits_;
+  std::thread       buildThread_;
+  std::atomic<bool> buildDone_     { false };
+  std::atomic<bool> buildCancel_   { false };
+  bool              buildStale_    { false }; // edit log dropped
+  uint              noUndoDepth_   { 0 };
+  bool              noUndoChanged_ { false };
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CTEXT_FILE_REG_EXP_CACHE_H
+#define CTEXT_FILE_REG_EXP_CACHE_H
+
+#include <CRegExp.h>
+#include <CTextFileLineRegExp.h>
+#include <string>
+#include <list>
+#include <map>
+#include <memory>
+#include <sys/types.h>
+
+#define CTextFileRegExpCacheInst CTextFileRegExpCache::instance()
+
+typedef std::shared_ptr<CRegExp> CRegExpP;
+
+// LRU cache of compiled regular expressions (keyed by pattern and case sensitivity)
+// shared by ed, vi and normal key handlers. An entry also holds the pattern compiled
+// for in place matching at line offsets (CTextFileLineRegExp) once it is asked for.
+//
+// Note: a CRegExp stores its last match so a cached expression must only be used
+// by one thread at a time. Each thread has its own cache (so no locking), and worker
+// threads given an expression from another thread should use their own copy.
+class CTextFileRegExpCache {
+ public:
+  static CTextFileRegExpCache *instance();
+
+  uint getMaxSize() const { return maxSize_; }
+  void setMaxSize(uint n);
+
+  uint getSize() const { return uint(entries_.size()); }
+
+  CRegExpP getRegExp(const std::string &pattern, bool caseSensitive=true);
+
+  CTextFileLineRegExpP getLineRegExp(const std::string &pattern, bool caseSensitive=true);
+
+  void clear();
+
+ private:
+  CTextFileRegExpCache();
+
+  CTextFileRegExpCache(const CTextFileRegExpCache &rhs);
+  CTextFileRegExpCache &operator=(const CTextFileRegExpCache &rhs);
+
+  void purge();
+
+ private:
+  typedef std::pair<std::string,bool> Key;
+
+  // compiled expressions (created when first asked for)
+  struct Entry {
+    Key                  key;
+    CRegExpP             regexp;
+    CTextFileLineRegExpP lineRegexp;
+
+    Entry(const Key &key1) :
+     key(key1) {
+    }
+  };
+
+  typedef std::list<Entry>                       Entries;
+  typedef std::map<Key,Entries::iterator>        EntryMap;
+
+  // entry for key moved to front (added if new)
+  Entry &getEntry(const Key &key);
+
+  uint     maxSize_ { 32 };
+  Entries  entries_;  // most recently used first
+  EntryMap entryMap_;
+};
+
+#endif
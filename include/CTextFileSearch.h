@@ -0,0 +1,129 @@
+#ifndef CTEXT_FILE_SEARCH_H
+#define CTEXT_FILE_SEARCH_H
+
+#include <CTextFile.h>
+#include <CTextFileUtil.h>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <sys/types.h>
+
+class CTextFileTrigramIndex;
+class CTextFileSubst;
+class CRegExp;
+
+struct CTextFileTrigramSig;
+
+// Multi-threaded search of a range of whole lines.
+//
+// The range is split into chunks which are claimed in search order by a process wide
+// pool of worker threads (created once and reused by all searches and sorts). Once a
+// chunk matches, workers stop scanning any chunk further from the search start, so the
+// result is always the one a sequential scan would find.
+//
+// Matching and substituting all lines of a range (:g and :s) also splits the range into
+// chunks. Results are kept per chunk and joined in line order, so they are identical
+// to a sequential run.
+//
+// Each worker uses its own copy of the regular expression (a CRegExp stores its last
+// match). The file must not be modified while a search is running, or a snapshot of
+// the file's lines can be searched instead (e.g. in a background thread).
+class CTextFileSearch {
+ public:
+  typedef CTextFileUtil::LineNums LineNums;
+
+  // number of affected lines and matches, and the first affected lines (dry run)
+  struct Count {
+    uint                     numLines   { 0 };
+    uint                     numMatches { 0 };
+    CTextFileUtil::LineEdits lines;
+  };
+
+ public:
+  CTextFileSearch(const CTextFile *file, const CTextFileUtil *util);
+  CTextFileSearch(const CTextLineList *lines, const CTextFileUtil *util);
+
+  // number of worker threads (0 for hardware concurrency)
+  static uint getNumThreads();
+  static void setNumThreads(uint n);
+
+  // number of lines below which a sequential scan is used
+  static uint getMinLines();
+  static void setMinLines(uint n);
+
+  static bool isParallel(int line_num1, int line_num2);
+
+  // run proc(i) for i in [0, n) on the shared worker pool (and the calling thread)
+  static void runParallel(uint n, const std::function<void (uint)> &proc);
+
+  // stop counting when flag set
+  void setCancel(const std::atomic<bool> *cancel) { cancel_ = cancel; }
+
+  // skip blocks of lines which index says can't contain trigrams of sig
+  void setIndex(const CTextFileTrigramIndex *index, const CTextFileTrigramSig *sig) {
+    index_ = index; sig_ = index ? sig : nullptr; }
+
+  // find first line in range [line_num1, line_num2] with a match
+  bool findNext(const std::string &pattern, uint line_num1, uint line_num2,
+                uint *fline_num, uint *fchar_num, bool caseSensitive=true) const;
+  bool findNext(const CRegExp &pattern, uint line_num1, uint line_num2,
+                uint *fline_num, uint *spos, uint *epos) const;
+
+  // find last line in range [line_num1, line_num2] with a match
+  bool findPrev(const std::string &pattern, uint line_num1, uint line_num2,
+                uint *fline_num, uint *fchar_num, bool caseSensitive=true) const;
+  bool findPrev(const CRegExp &pattern, uint line_num1, uint line_num2,
+                uint *fline_num, uint *spos, uint *epos) const;
+
+  // all lines in range [line_num1, line_num2] with a match, or without if invert
+  // (in line order)
+  void matchLines(const CRegExp &pattern, uint line_num1, uint line_num2,
+                  bool invert, LineNums &lines) const;
+
+  // new text of all lines in range [line_num1, line_num2] changed by subst (in line order)
+  void substLines(const CTextFileSubst &subst, uint line_num1, uint line_num2,
+                  CTextFileUtil::LineEdits &edits) const;
+
+  // count lines (and matches) in range which match, or don't match if invert, keeping
+  // the first maxLines lines (false if cancelled)
+  bool countLines(const CRegExp &pattern, uint line_num1, uint line_num2, bool invert,
+                  uint maxLines, Count &count) const;
+
+  // count lines in range changed by subst and substitutions, keeping the new text of
+  // the first maxLines changed lines (false if cancelled)
+  bool countSubst(const CTextFileSubst &subst, uint line_num1, uint line_num2,
+                  uint maxLines, Count &count) const;
+
+ private:
+  typedef std::function<bool (const std::string &, uint *, uint *)> LineMatcher;
+  typedef std::function<LineMatcher ()>                             LineMatcherFactory;
+
+  bool findLines(const LineMatcherFactory &factory, uint line_num1, uint line_num2,
+                 bool forward, uint *fline_num, uint *spos, uint *epos) const;
+
+  // process lines [line_num1, line_num2] of chunk
+  typedef std::function<void (uint chunk, uint line_num1, uint line_num2)> ChunkProc;
+  typedef std::function<ChunkProc ()>                                      ChunkProcFactory;
+
+  uint getNumChunks(uint line_num1, uint line_num2, uint *chunkSize) const;
+
+  static void joinCounts(std::vector<Count> &chunkCounts, uint maxLines, Count &count);
+
+  const std::string &getLine(uint line_num) const {
+    return (lines_ ? (*lines_)[line_num]->getString() : file_->getLine(line_num)); }
+
+  bool isCancelled() const { return (cancel_ && *cancel_); }
+
+  void processChunks(const ChunkProcFactory &factory, uint line_num1, uint line_num2) const;
+
+ private:
+  const CTextFile             *file_   { nullptr };
+  const CTextLineList         *lines_  { nullptr };
+  const CTextFileUtil         *util_   { nullptr };
+  const CTextFileTrigramIndex *index_  { nullptr };
+  const CTextFileTrigramSig   *sig_    { nullptr };
+  const std::atomic<bool>     *cancel_ { nullptr };
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef CTEXT_FILE_SHARED_BUFFER_H
+#define CTEXT_FILE_SHARED_BUFFER_H
+
+#include <CTextFile.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Named buffer (register) in a POSIX shared memory segment shared by all editor
+// instances of the user on the machine.
+//
+// The segment holds a header, a table of line offsets, a newline flag per line and
+// the line text. It is written in one pass (no string building or clipboard
+// serialization) and another instance maps it and creates its lines directly from the
+// mapped text. A sequence number in the header lets a reader skip reading a buffer
+// it already has. Readers and writers lock the segment so a buffer is never read
+// while it is being written.
+class CTextFileSharedBuffer {
+ public:
+  typedef std::vector<bool> NewLines;
+
+ public:
+  CTextFileSharedBuffer(char id);
+
+  // segment name for buffer
+  const std::string &getName() const { return name_; }
+
+  // write lines (replacing current contents) and return new sequence number (0 on error)
+  uint64_t write(const CTextLineList &lines, const NewLines &newlines);
+
+  // sequence number of current contents (0 if none or error)
+  uint64_t getSeq() const;
+
+  // read lines (created in file) and sequence number of contents (false if none)
+  bool read(CTextFile *file, CTextLineList &lines, NewLines &newlines, uint64_t *seq) const;
+
+  // remove segment
+  void remove();
+
+  // error of last write, getSeq or read (empty if ok or no segment)
+  const std::string &getError() const { return error_; }
+
+ private:
+  std::string         name_;
+  mutable std::string error_;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef CTEXT_FILE_SORT_H
+#define CTEXT_FILE_SORT_H
+
+#include <CTextFile.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class CRegExp;
+
+// Sort a range of lines (ed sort [n][u][r][i] [/<regexp>/]).
+//
+// Lines are sorted on a key which is the whole line, or the text after the first
+// match of a pattern (lines without a match have an empty key). Text keys are views of
+// the line strings sorted with a parallel merge sort, and numeric keys (the first
+// decimal number in the key, lines without a number first) with a radix sort. Both
+// sorts are stable, and the lines (shared, not copied) are replaced in one splice.
+class CTextFileSort {
+ public:
+  CTextFileSort(CTextFile *file);
+
+  // sort on first number in key
+  bool isNumeric() const { return numeric_; }
+  void setNumeric(bool b) { numeric_ = b; }
+
+  // only keep first of lines with equal keys
+  bool isUnique() const { return unique_; }
+  void setUnique(bool b) { unique_ = b; }
+
+  // sort in descending order
+  bool isReverse() const { return reverse_; }
+  void setReverse(bool b) { reverse_ = b; }
+
+  bool isCaseSensitive() const { return caseSensitive_; }
+  void setCaseSensitive(bool b) { caseSensitive_ = b; }
+
+  // sort on text after match of pattern (empty for whole line)
+  const std::string &getPattern() const { return pattern_; }
+  void setPattern(const std::string &pattern) { pattern_ = pattern; }
+
+  // sort lines [line_num1, line_num2] (false if lines unchanged)
+  bool sort(uint line_num1, uint line_num2);
+
+  // number of lines removed by unique
+  uint getNumRemoved() const { return numRemoved_; }
+
+ private:
+  typedef std::vector<uint> Indices;
+
+  void makeKeys(const CTextLineList &lines);
+
+  std::string_view getKey(const std::string &line, const CRegExp *regexp) const;
+
+  void sortText   (Indices &inds) const;
+  void sortNumeric(Indices &inds) const;
+
+  bool lessText (uint i1, uint i2) const;
+  bool equalKeys(uint i1, uint i2) const;
+
+ private:
+  typedef std::vector<std::string_view> TextKeys;
+  typedef std::vector<uint64_t>         NumericKeys;
+
+  CTextFile*  file_          { nullptr };
+  bool        numeric_       { false };
+  bool        unique_        { false };
+  bool        reverse_       { false };
+  bool        caseSensitive_ { true };
+  std::string pattern_;
+  uint        numRemoved_    { 0 };
+  TextKeys    textKeys_;
+  NumericKeys numericKeys_;
+};
+
+#endif
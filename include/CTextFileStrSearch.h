@@ -0,0 +1,21 @@
+#ifndef CTEXT_FILE_STR_SEARCH_H
+#define CTEXT_FILE_STR_SEARCH_H
+
+#include <sys/types.h>
+
+// Literal substring search kernel.
+//
+// Candidate positions are found a block at a time by comparing the first and last
+// pattern characters (SSE2 or AVX2 when available) and only candidates are compared
+// in full. Falls back to memmem (Two-Way) for case sensitive search when no SIMD.
+namespace CTextFileStrSearch {
+  // position of first occurrence of pattern which fits in str[0, len) or -1
+  int findNext(const char *str, uint len, const char *pattern, uint plen,
+               bool caseSensitive=true);
+
+  // position of last occurrence of pattern which fits in str[0, len) or -1
+  int findPrev(const char *str, uint len, const char *pattern, uint plen,
+               bool caseSensitive=true);
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CTEXT_FILE_SUBST_H
+#define CTEXT_FILE_SUBST_H
+
+#include <sys/types.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CTextFileLineRegExp;
+
+// Substitute (:s) of regexp matches in a line.
+//
+// The replacement is parsed once into text, match references (& or \0 for the
+// whole match, \1-\9 for sub matches) and case changes (\u, \l, \U, \L, \e, \E),
+// with \n or \r for a line break and \t for a tab, and each new line is built in one
+// pass over all of its matches. Copies share nothing so a copy can be used in each
+// thread.
+//
+// Each match is found in place at its start position in the whole line
+// (CTextFileLineRegExp), so a global substitute copies nothing to match and ^, \< and
+// \b see the chars before the match.
+class CTextFileSubst {
+ public:
+  CTextFileSubst(const std::string &find, const std::string &replace,
+                 bool global=false, bool caseSensitive=true);
+
+  CTextFileSubst(const CTextFileSubst &subst);
+
+ ~CTextFileSubst();
+
+  const std::string &getFind() const { return find_; }
+
+  const std::string &getReplace() const { return replace_; }
+
+  bool isGlobal() const { return global_; }
+
+  bool isCaseSensitive() const { return caseSensitive_; }
+
+  // build substituted line, with '\n' at line breaks (returns number of substitutions,
+  // 0 if no match)
+  uint substLine(const std::string &line, std::string &newLine);
+
+ private:
+  CTextFileSubst &operator=(const CTextFileSubst &rhs);
+
+  // case change of replacement text
+  enum class CaseOp {
+    NONE,
+    UPPER_NEXT, // \u
+    LOWER_NEXT, // \l
+    UPPER,      // \U
+    LOWER,      // \L
+    END         // \e or \E
+  };
+
+  // replacement text (ref < 0 and no case op), match reference (0 whole match, n sub
+  // match n) or case change
+  struct Part {
+    std::string text;
+    int         ref    { -1 };
+    CaseOp      caseOp { CaseOp::NONE };
+  };
+
+  typedef std::vector<Part> Parts;
+
+  void parseReplace();
+
+  // add replacement of match [spos, epos] of line (last match of regexp)
+  void addReplace(const std::string &line, int spos, int epos, std::string &newLine) const;
+
+ private:
+  std::string                          find_;
+  std::string                          replace_;
+  bool                                 global_        { false };
+  bool                                 caseSensitive_ { true };
+  std::unique_ptr<CTextFileLineRegExp> regexp_;
+  Parts                                parts_;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef CTEXT_FILE_TRIGRAM_INDEX_H
+#define CTEXT_FILE_TRIGRAM_INDEX_H
+
+#include <CTextFile.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// (case folded) trigrams required by a search, as hashes
+struct CTextFileTrigramSig {
+  std::vector<uint64_t> hashes; // sorted, unique
+
+  bool isEmpty() const { return hashes.empty(); }
+};
+
+// Optional per file trigram index used to skip blocks of lines which can't match a
+// search.
+//
+// The lines are split into blocks (of about 64 lines) and each block has a bloom filter
+// of its trigrams sized to the number of distinct trigrams in the block (about 10 bits
+// each, with 3 hashes), so a search skips a block unless it may contain all the
+// trigrams of the search. The blocks are found from a line with a Fenwick tree of
+// block line counts, so an edit only changes the counts and marks the edited blocks,
+// which are rebuilt from their lines before the next search. The index is (re)built in
+// a background thread from a snapshot of the lines after a file is opened or after a
+// bulk (no undo) edit. Edits made while building are logged and replayed on the built
+// index. Searches only use the index when it is valid.
+class CTextFileTrigramIndex : public CTextFileNotifier {
+ public:
+  // Lines of a search in order, skipping blocks which can't contain the trigrams of
+  // sig (no lines are skipped if no index)
+  class Scan {
+   public:
+    Scan(const CTextFileTrigramIndex *index, const CTextFileTrigramSig *sig,
+         bool forward=true);
+
+    // first line at or after line_num (at or before if backward) which may match
+    // (-1 if none)
+    int nextLine(int line_num);
+
+   private:
+    const CTextFileTrigramIndex *index_   { nullptr };
+    const CTextFileTrigramSig   *sig_     { nullptr };
+    bool                         forward_ { true };
+    int                          start_   { 0 };     // lines of last matching block
+    int                          end_     { -1 };
+  };
+
+ public:
+  CTextFileTrigramIndex(CTextFile *file);
+ ~CTextFileTrigramIndex();
+
+  CTextFile *getFile() const { return file_; }
+
+  // true if index is current (merges completed background build and updates edited
+  // blocks from the file)
+  bool isValid();
+
+  // lines [*start, *end] of first block containing or after line_num (before if
+  // backward) which may contain all trigrams of sig (false if none)
+  bool findBlock(uint line_num, const CTextFileTrigramSig &sig, bool forward,
+                 uint *start, uint *end) const;
+
+  // signature of trigrams required by literal or regexp (false if none)
+  static bool literalSignature(const std::string &str, CTextFileTrigramSig &sig);
+  static bool regexpSignature (const std::string &pattern, CTextFileTrigramSig &sig);
+
+  // number of blocks and fraction of blocks (and lines) skipped for sig
+  uint getNumBlocks() const { return uint(blocks_.size()); }
+
+  void skipStats(const CTextFileTrigramSig &sig, double *blocks, double *lines) const;
+
+  void rebuild();
+
+  // notifier
+  void fileOpened(const std::string &fileName) override;
+
+  void lineAdded   (const std::string &line, uint line_num) override;
+  void lineDeleted (const std::string &line, uint line_num) override;
+  void lineReplaced(const std::string &line1, const std::string &line2, uint line_num) override;
+
+  void charAdded   (char c, uint line_num, uint char_num) override;
+  void charDeleted (char c, uint line_num, uint char_num) override;
+  void charReplaced(char c1, char c2, uint line_num, uint char_num) override;
+
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines) override;
+
+  void startNoUndo() override;
+  void endNoUndo  () override;
+
+ private:
+  CTextFileTrigramIndex(const CTextFileTrigramIndex &rhs);
+  CTextFileTrigramIndex &operator=(const CTextFileTrigramIndex &rhs);
+
+  typedef std::vector<uint64_t> Bits;
+  typedef std::vector<uint32_t> Trigrams;
+
+  // lines of block and bloom filter of their trigrams
+  struct Block {
+    uint numLines { 0 };
+    Bits bits;            // size is a power of 2
+    bool dirty    { true };
+  };
+
+  typedef std::vector<Block> Blocks;
+
+  // edit applied to blocks (replace n lines at line_num by count lines)
+  struct Edit {
+    uint line_num { 0 };
+    uint n        { 0 };
+    uint count    { 0 };
+  };
+
+  typedef std::vector<Edit> Edits;
+
+  // work data for building blocks
+  struct BlockData {
+    Trigrams trigrams;
+    Bits     seen;     // bit per trigram value
+  };
+
+  // case folded trigrams of str added to trigrams
+  static void addTrigrams(const std::string &str, Trigrams &trigrams);
+
+  // set sig to hashes of (unique) trigrams
+  static void setSignature(Trigrams &trigrams, CTextFileTrigramSig &sig);
+
+  static uint64_t trigramHash(uint32_t trigram);
+
+  // set bloom filter of block from its lines (starting at lines[i1])
+  static void buildBlock(Block &block, const CTextLineList &lines, uint i1,
+                         BlockData &data);
+
+  static bool blockCanMatch(const Block &block, const CTextFileTrigramSig &sig);
+
+  void addEdit(uint line_num, uint n, uint count);
+
+  bool applyEdit(const Edit &edit);
+
+  // split large, merge small and remove empty blocks and rebuild tree
+  void resizeBlocks();
+
+  // add d lines to count of block i in tree
+  void addTreeLines(uint i, int d);
+
+  // block containing line and its first line
+  uint lineBlock(uint line_num, uint *start) const;
+
+  // rebuild filters of edited blocks from the file
+  void updateBlocks();
+
+  void invalidate();
+
+  void cancelBuild();
+
+ private:
+  enum class State {
+    INVALID,
+    BUILDING,
+    VALID
+  };
+
+  typedef std::vector<uint> Tree;
+
+  CTextFile*        file_        { nullptr };
+  State             state_       { State::INVALID };
+  Blocks            blocks_;
+  Tree              tree_;                     // Fenwick tree of block line counts
+  uint              numLines_    { 0 };
+  bool              dirty_       { false };    // any edited blocks
+  Blocks            buildBlocks_;
+  Edits             buildEdits_;
+  std::thread       buildThread_;
+  std::atomic<bool> buildDone_   { false };
+  std::atomic<bool> buildCancel_ { false };
+  bool              buildStale_  { false };    // edit log dropped
+  uint              noUndoDepth_ { 0 };
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <CTextFile.h>
 #include <CUndo.h>
+#include <ctime>
 
 class CTextFileUndo;
 
@@ -111,6 +112,70 @@ class CTextFileUndoReplaceCharCmd : public CTextFileUndoCmd {
 
 //---
 
+class CTextFileUndoSpliceLinesCmd : public CTextFileUndoCmd {
+ public:
+  CTextFileUndoSpliceLinesCmd(CTextFileUndo *undo, uint line_num,
+                              const CTextLineList &oldLines, const CTextLineList &newLines);
+
+  const char *getName() const { return "splice_lines"; }
+
+  bool exec();
+
+ private:
+  CTextLineList oldLines_;
+  CTextLineList newLines_;
+};
+
+//---
+
+// Persistent line table for checkpoints.
+//
+// The lines are held in chunks of shared line pointers. A checkpoint copies the
+// chunk list (not the lines) and an edit only replaces the chunks it touches (a chunk
+// shared with a checkpoint is copied first), so checkpoints of a large file share all
+// their unchanged chunks.
+class CTextFileLineTable {
+ public:
+  typedef std::shared_ptr<CTextLineList> Chunk;
+  typedef std::vector<Chunk>             Chunks;
+
+ public:
+  CTextFileLineTable() { }
+
+  uint getNumLines() const { return numLines_; }
+
+  const Chunks &getChunks() const { return chunks_; }
+
+  void assign(const CTextLineList &lines);
+
+  void clear();
+
+  // replace n lines at line_num by lines
+  void splice(uint line_num, uint n, const CTextLineList &lines);
+
+  void setLine(uint line_num, const CTextLineP &line);
+
+  // lines of chunk list
+  static CTextLineList toLines(const Chunks &chunks);
+
+ private:
+  typedef std::vector<uint> Starts;
+
+  // chunk containing line
+  uint findChunk(uint line_num) const;
+
+  void updateStarts(uint i);
+
+ private:
+  static const uint s_maxChunkSize = 1024;
+
+  Chunks chunks_;
+  Starts starts_;              // first line of each chunk
+  uint   numLines_ { 0 };
+};
+
+//---
+
 class CTextFileUndo : public CTextFileNotifier {
  public:
   CTextFileUndo(CTextFile *file);
@@ -127,6 +192,25 @@ class CTextFileUndo : public CTextFileNotifier {
 
   bool getDebug() const { return debug_; }
 
+  // no undo region (edits not recorded, history reset at end if changed)
+  void startNoUndo();
+  void endNoUndo  ();
+
+  bool isRecording() const;
+
+  // checkpoints (line table of file taken every checkpointInterval changes)
+  uint getCheckpointInterval() const { return checkpointInterval_; }
+  void setCheckpointInterval(uint n) { checkpointInterval_ = n; }
+
+  uint getNumCheckpoints() const { return uint(checkpoints_.size()); }
+
+  uint addCheckpoint();
+
+  bool restoreCheckpoint(uint i);
+
+  bool restoreEarlier(uint secs);
+  bool restoreLater();
+
   // notifier interface
   void fileOpened  (const std::string &filename);
   void lineAdded   (const std::string &line, uint line_num);
@@ -135,15 +219,47 @@ class CTextFileUndo : public CTextFileNotifier {
   void charAdded   (char c, uint line_num, uint char_num);
   void charDeleted (char c, uint line_num, uint char_num);
   void charReplaced(char c1, char c2, uint line_num, uint char_num);
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines);
 
   void startGroup();
   void endGroup  ();
 
  private:
+  bool canAddUndo();
+
   void addUndo(CTextFileUndoCmd *cmd);
 
+  void changeDone();
+
+  // keep line table in step with file
+  void updateLines(uint line_num, uint n, const CTextLineList &lines);
+  void updateLine (uint line_num);
+
  private:
-  CTextFile *file_ { nullptr };
-  CUndo      undo_;
-  bool       debug_ { false };
+  struct Checkpoint {
+    time_t                     time { 0 };
+    CTextFileLineTable::Chunks chunks;
+    uint                       x { 0 };
+    uint                       y { 0 };
+  };
+
+  typedef std::vector<Checkpoint> Checkpoints;
+  typedef std::vector<time_t>     Times;
+
+  CTextFile          *file_ { nullptr };
+  CUndo               undo_;
+  bool                debug_ { false };
+  Checkpoints         checkpoints_;
+  uint                checkpointInterval_ { 100 };
+  uint                maxCheckpoints_ { 64 };
+  uint                numChanges_ { 0 };         // changes since last checkpoint
+  uint                groupDepth_ { 0 };
+  bool                groupChanged_ { false };
+  bool                restoring_ { false };
+  uint                noUndoDepth_ { 0 };
+  bool                noUndoChanged_ { false };
+  Times               restoreTimes_;             // times of restored checkpoints (for later)
+  CTextFileLineTable  lines_;                    // current lines (shared with checkpoints)
+  bool                linesValid_ { false };     // lines not updated in no undo region
 };
@@ -3,10 +3,14 @@
 
 #include <sys/types.h>
 #include <string>
+#include <vector>
 
 class CTextFile;
+class CTextFileTrigramIndex;
 class CRegExp;
 
+struct CTextFileTrigramSig;
+
 class CTextFileUtil {
  public:
   CTextFileUtil(CTextFile *file);
@@ -69,25 +73,36 @@ class CTextFileUtil {
   bool isSection(const std::string &line, uint, uint *n) const;
 
   bool findNext(const std::string &pattern, uint line_num1, int char_num1,
-                int line_num2, int char_num2, uint *fline_num, uint *fchar_num);
+                int line_num2, int char_num2, uint *fline_num, uint *fchar_num,
+                bool case_sensitive=true);
   bool findNext(const CRegExp &pattern, uint line_num1, int char_num1,
                 int line_num2, int char_num2, uint *fline_num, uint *fchar_num, uint *len);
 
   bool lineFindNext(const std::string &line, const std::string &pattern,
-                    int char_num1, int char_num2, uint *char_num) const;
+                    int char_num1, int char_num2, uint *char_num,
+                    bool case_sensitive=true) const;
   bool lineFindNext(const std::string &line, const CRegExp &pattern,
                     int char_num1, int char_num2, uint *spos, uint *epos) const;
 
   bool findPrev(const std::string &pattern, uint line_num1, int char_num1,
-                int line_num2, int char_num2, uint *fline_num, uint *fchar_num);
+                int line_num2, int char_num2, uint *fline_num, uint *fchar_num,
+                bool case_sensitive=true);
   bool findPrev(const CRegExp &pattern, uint line_num1, int char_num1,
                 int line_num2, int char_num2, uint *fline_num, uint *fchar_num, uint *len);
 
   bool lineFindPrev(const std::string &line, const std::string &pattern,
-                    int char_num1, int char_num2, uint *char_num) const;
+                    int char_num1, int char_num2, uint *char_num,
+                    bool case_sensitive=true) const;
   bool lineFindPrev(const std::string &line, const CRegExp &pattern,
                     int char_num1, int char_num2, uint *spos, uint *epos) const;
 
+  // true if regexp pattern has no special chars (so can be searched for as a literal)
+  static bool isLiteralPattern(const std::string &pattern);
+
+  // search index and signature for pattern (nullptr if no valid index or no trigrams)
+  CTextFileTrigramIndex *getSearchIndex(const std::string &pattern, bool regexp,
+                                        CTextFileTrigramSig &sig) const;
+
   bool findNextChar(uint line_num, int char_num, char c, bool multiline);
   bool findNextChar(uint line_num, int char_num, const std::string &chars, bool multiline);
 
@@ -103,8 +118,43 @@ class CTextFileUtil {
 
   void copyLine(uint line_num1, uint line_num2);
 
+  // range operations with one splice (lines are shared, not copied)
+
+  // move lines [line_num1, line_num2] after line line_num3 (-1 for before first line)
+  void moveLines(uint line_num1, uint line_num2, int line_num3);
+
+  // copy lines [line_num1, line_num2] after line line_num3 (-1 for before first line)
+  void copyLines(uint line_num1, uint line_num2, int line_num3);
+
+  // join lines [line_num1, line_num2] into one line
+  void joinLines(uint line_num1, uint line_num2);
+
   void replace(uint line_num, uint char_num1, uint char_num2, const std::string &replaceStr);
 
+  // new line text for line
+  struct LineEdit {
+    uint        line_num { 0 };
+    std::string line;
+  };
+
+  typedef std::vector<LineEdit> LineEdits;
+
+  // replace lines (sorted by line number) with a splice for each run of nearby lines.
+  // A '\n' in new text splits the line. Returns new line number of last edited line
+  uint replaceLines(const LineEdits &edits);
+
+  typedef std::vector<uint> LineNums;
+
+  // delete lines (sorted by line number) with one splice of the remaining lines
+  void deleteLines(const LineNums &lines);
+
+  // delete lines [line_num1, line_num2] with one splice
+  void deleteLines(uint line_num1, uint line_num2);
+
+  // lines in range [line_num1, line_num2] equal to the previous line (adjacent) or to
+  // any earlier line in the range (in line order)
+  void duplicateLines(uint line_num1, uint line_num2, bool adjacent, LineNums &lines) const;
+
   void deleteTo(uint line_num1, uint char_num1, uint line_num2, uint char_num2);
 
   //void deleteChars(uint line_num, uint char_num, int num);
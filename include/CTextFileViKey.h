@@ -7,6 +7,7 @@
 
 class CTextFileBuffer;
 class CTextFileMarks;
+class CTextFileTrigramIndex;
 
 class CTextFileViKey : public CTextFileKey, public CTextFileNotifier, public CTextFileEdNotifier {
  private:
@@ -68,36 +69,51 @@ class CTextFileViKey : public CTextFileKey, public CTextFileNotifier, public CTe
 
   void edNotifyQuit(bool force);
 
+  bool edNotifyFilterProgress(uint numLines, uint totalLines);
+
+  bool edNotifyOutput(const std::string &text);
+
+  bool edNotifyCount(uint numMatches, uint numLines, const std::string &msg);
+
+  // report (and clear) error of shared buffer store or load by last command
+  void checkBufferError();
+
   void error(const std::string &mgs) const;
 
  private:
   typedef std::map<std::string,std::string> OptionMap;
 
   struct Options {
-    bool ignorecase { false };
-    bool list       { false };
-    bool number     { false };
-    bool showmatch  { false };
-    uint shiftwidth { 2 };
+    bool ignorecase  { false };
+    bool list        { false };
+    bool number      { false };
+    bool showmatch   { false };
+    uint shiftwidth  { 2 };
+    bool searchindex { false };
+    bool hlsearch    { false };
 
     Options() { }
   };
 
-  CTextFileMarks  *marks_       { nullptr };
-  CTextFileBuffer *buffer_      { nullptr };
-  CTextFileEd     *ed_          { nullptr };
-  CKeyType         lastKey_;
-  uint             count_       { 0 };
-  bool             insertMode_  { false };
-  bool             cmdLineMode_ { false };
-  char             register_    { '\0' };
-  LastCommand      lastCommand_;
-  char             findChar_    { '\0' };
-  bool             findForward_ { false };
-  bool             findTill_    { false };
-  bool             visual_      { false };
-  OptionMap        optionMap_;
-  Options          options_;
+  CTextFileMarks        *marks_       { nullptr };
+  CTextFileBuffer       *buffer_      { nullptr };
+  CTextFileEd           *ed_          { nullptr };
+  CTextFileTrigramIndex *searchIndex_ { nullptr };
+  CKeyType               lastKey_;
+  uint                   count_       { 0 };
+  bool                   insertMode_  { false };
+  bool                   cmdLineMode_ { false };
+  char                   register_    { '\0' };
+  LastCommand            lastCommand_;
+  char                   findChar_    { '\0' };
+  bool                   findForward_ { false };
+  bool                   findTill_    { false };
+  bool                   visual_      { false };
+  OptionMap              optionMap_;
+  std::string            edOutput_;              // ed command output (shown when done)
+  uint                   edOutputLines_   { 0 }; // lines in ed output
+  uint                   edOutputDropped_ { 0 }; // lines not added to ed output
+  Options                options_;
 };
 
 #endif
@@ -6,6 +6,8 @@
 #include <CTextFileEd.h>
 #include <CTextFileUndo.h>
 #include <CTextFileSel.h>
+#include <CTextFileMatchSet.h>
+#include <CTextFileUtil.h>
 #include <CQUtil.h>
 #include <CQWindow.h>
 #include <CFileUtil.h>
@@ -18,6 +20,7 @@
 #include <QPainter>
 #include <QApplication>
 #include <QClipboard>
+#include <QTimer>
 
 CQTextFile::
 CQTextFile(QWidget *parent) :
@@ -62,6 +65,20 @@ CQTextFile(QWidget *parent) :
   normalKey_ = new CTextFileNormalKey(file_);
   viKey_     = new CTextFileViKey(file_);
 
+  matchSet_ = new CTextFileMatchSet(file_);
+
+  matchTimer_ = new QTimer(this);
+
+  matchTimer_->setInterval(100);
+
+  connect(matchTimer_, SIGNAL(timeout()), this, SLOT(matchTimerSlot()));
+
+  dryRunTimer_ = new QTimer(this);
+
+  dryRunTimer_->setInterval(100);
+
+  connect(dryRunTimer_, SIGNAL(timeout()), this, SLOT(dryRunTimerSlot()));
+
   normalKey_->addNotifier(this);
   viKey_    ->addNotifier(this);
 
@@ -71,6 +88,13 @@ CQTextFile(QWidget *parent) :
   setFocusProxy(canvas_);
 }
 
+CQTextFile::
+~CQTextFile()
+{
+  // stops background match
+  delete matchSet_;
+}
+
 CTextFileKey *
 CQTextFile::
 getKey() const
@@ -152,6 +176,118 @@ setNumber(bool number)
   canvas_->forceUpdate();
 }
 
+void
+CQTextFile::
+notifyHlSearch(bool hlsearch)
+{
+  setHlSearch(hlsearch);
+}
+
+void
+CQTextFile::
+notifyFindPattern(const std::string &pattern)
+{
+  if (hlsearch_) {
+    setMatchPattern(pattern);
+
+    canvas_->forceUpdate();
+  }
+}
+
+void
+CQTextFile::
+setHlSearch(bool hlsearch)
+{
+  hlsearch_ = hlsearch;
+
+  if (hlsearch_)
+    setMatchPattern(getKey()->getFindPattern());
+  else {
+    matchSet_->clear();
+
+    matchTimer_->stop();
+  }
+
+  canvas_->forceUpdate();
+}
+
+void
+CQTextFile::
+setMatchPattern(const std::string &pattern)
+{
+  // match as key find next/prev does
+  CTextFileKey *key = getKey();
+
+  bool regexp = (key->isFindRegExp() && ! CTextFileUtil::isLiteralPattern(pattern));
+
+  matchSet_->setPattern(pattern, regexp, key->isCaseSensitive());
+
+  numMatches_ = -1;
+
+  updateMatchSet();
+}
+
+void
+CQTextFile::
+updateMatchSet()
+{
+  if (! hlsearch_ || matchSet_->getPattern().empty()) {
+    matchTimer_->stop();
+    return;
+  }
+
+  // poll until background match completes
+  if (! matchSet_->isComplete()) {
+    if (! matchTimer_->isActive())
+      matchTimer_->start();
+
+    return;
+  }
+
+  matchTimer_->stop();
+
+  int numMatches = matchSet_->getNumMatches();
+
+  if (numMatches != numMatches_) {
+    numMatches_ = numMatches;
+
+    getKey()->showStatusMsg(CStrUtil::strprintf("%d matches", numMatches_));
+  }
+}
+
+void
+CQTextFile::
+matchTimerSlot()
+{
+  updateMatchSet();
+
+  // redraw with merged spans
+  if (! matchTimer_->isActive())
+    canvas_->forceUpdate();
+}
+
+void
+CQTextFile::
+updateDryRun()
+{
+  // poll until count completes
+  if (! viKey_->getEd()->pollDryRun()) {
+    if (! dryRunTimer_->isActive())
+      dryRunTimer_->start();
+
+    return;
+  }
+
+  dryRunTimer_->stop();
+}
+
+void
+CQTextFile::
+dryRunTimerSlot()
+{
+  updateDryRun();
+}
+
 void
 CQTextFile::
 scrollToPos(CScrollType type)
@@ -297,6 +433,16 @@ paintEvent(QPaintEvent *)
 
   maxLineLen_ = 0;
 
+  // match visible rows first (and pick up completed background match)
+  if (textFile_->getHlSearch()) {
+    uint row1 = y_offset_/char_height_;
+    uint row2 = (y_offset_ + height())/char_height_;
+
+    textFile_->getMatchSet()->updateRows(row1, row2);
+
+    textFile_->updateMatchSet();
+  }
+
   CTextFile::LineIterator pl1, pl2;
 
   for (pl1 = file->beginLine(), pl2 = file->endLine(); pl1 != pl2; ++pl1) {
@@ -376,6 +522,13 @@ drawLine(QPainter *painter, int x, int y, uint row, const std::string &line)
   bool line_part_sel = sel->isPartLineInside(row);
   bool line_sel      = sel->isLineInside(row);
 
+  const CTextFileMatchSet::Spans *spans = nullptr;
+
+  if (textFile_->getHlSearch())
+    spans = &textFile_->getMatchSet()->getLineSpans(row);
+
+  uint ispan = 0;
+
   char cstr[2];
 
   cstr[1] = '\0';
@@ -399,6 +552,14 @@ drawLine(QPainter *painter, int x, int y, uint row, const std::string &line)
         char_sel = sel->isCharInside(row, col);
       }
 
+      if (spans) {
+        while (ispan < spans->size() && (*spans)[ispan].end < col)
+          ++ispan;
+
+        if (ispan < spans->size() && (*spans)[ispan].start <= col)
+          painter->fillRect(QRect(x, y, cs*char_width_, char_height_), QColor(255, 200, 120));
+      }
+
       if (char_sel)
         painter->fillRect(QRect(x, y, cs*char_width_, char_height_), QColor(255, 255, 0));
 
@@ -623,6 +784,9 @@ keyPressEvent(QKeyEvent *e)
   CKeyEvent *event = CQUtil::convertEvent(e);
 
   textFile_->getKey()->processChar(event->getType(), event->getText(), event->getModifier());
+
+  // command may have started a dry run count
+  textFile_->updateDryRun();
 }
 
 void
@@ -775,6 +939,15 @@ charDeleted(char, uint, uint)
   forceUpdate();
 }
 
+void
+CQTextFileCanvas::
+linesSpliced(uint, const CTextLineList &, const CTextLineList &)
+{
+  scroll_update_ = true;
+
+  forceUpdate();
+}
+
 void
 CQTextFileCanvas::
 forceUpdate()
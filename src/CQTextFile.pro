@@ -17,11 +17,25 @@ SOURCES += \
 CQTextFile.cpp \
 CTextFileBuffer.cpp \
 CTextFile.cpp \
+CTextFileDryRun.cpp \
 CTextFileEd.cpp \
+CTextFileEdScript.cpp \
+CTextFileFilter.cpp \
+CTextFileGlobMarks.cpp \
+CTextFileIncSearch.cpp \
 CTextFileKey.cpp \
+CTextFileLineRegExp.cpp \
 CTextFileMarks.cpp \
+CTextFileMatchSet.cpp \
 CTextFileNormalKey.cpp \
+CTextFileRegExpCache.cpp \
+CTextFileSearch.cpp \
 CTextFileSel.cpp \
+CTextFileSharedBuffer.cpp \
+CTextFileSort.cpp \
+CTextFileStrSearch.cpp \
+CTextFileSubst.cpp \
+CTextFileTrigramIndex.cpp \
 CTextFileUndo.cpp \
 CTextFileUtil.cpp \
 CTextFileViKey.cpp \
@@ -30,12 +44,26 @@ HEADERS += \
 CQTextFileCanvas.h \
 ../include/CQTextFile.h \
 ../include/CTextFileBuffer.h \
+../include/CTextFileDryRun.h \
 ../include/CTextFileEd.h \
+../include/CTextFileEdScript.h \
+../include/CTextFileFilter.h \
 ../include/CTextFile.h \
+../include/CTextFileGlobMarks.h \
+../include/CTextFileIncSearch.h \
 ../include/CTextFileKey.h \
+../include/CTextFileLineRegExp.h \
 ../include/CTextFileMarks.h \
+../include/CTextFileMatchSet.h \
 ../include/CTextFileNormalKey.h \
+../include/CTextFileRegExpCache.h \
+../include/CTextFileSearch.h \
 ../include/CTextFileSel.h \
+../include/CTextFileSharedBuffer.h \
+../include/CTextFileSort.h \
+../include/CTextFileStrSearch.h \
+../include/CTextFileSubst.h \
+../include/CTextFileTrigramIndex.h \
 ../include/CTextFileUndo.h \
 ../include/CTextFileUtil.h \
 ../include/CTextFileViKey.h \
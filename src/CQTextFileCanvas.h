@@ -43,6 +43,8 @@ class CQTextFileCanvas : public CQWindow, public CTextFileNotifier {
   void charAdded   (char c, uint line_num, uint char_num);
   void charDeleted (char c, uint line_num, uint char_num);
   void charReplaced(char c1, char c2, uint line_num, uint char_num);
+  void linesSpliced(uint line_num, const CTextLineList &oldLines,
+                    const CTextLineList &newLines);
 
   void forceUpdate();
 
@@ -1,5 +1,6 @@
 #include <CTextFile.h>
 #include <CFile.h>
+#include <algorithm>
 
 CTextFile::
 CTextFile(const char *filename)
@@ -44,12 +45,14 @@ read(const char *filename)
   if (! file.exists() || ! file.isRegular())
     return false;
 
-  removeAllLines();
-
   std::vector<std::string> lines;
 
   file.toLines(lines);
 
+  startNoUndo();
+
+  removeAllLines();
+
   uint numLines = uint(lines.size());
 
   for (uint i = 0; i < numLines; ++i) {
@@ -62,6 +65,8 @@ read(const char *filename)
 
   notifyMgr_->notifyFileOpened();
 
+  endNoUndo();
+
   cursor_.moveTo(0, 0);
 
   notifyMgr_->notifyPositionChanged();
@@ -102,7 +107,7 @@ removeAllLines()
   uint numLines = getNumLines();
 
   for (int y = numLines - 1; y >= 0; --y) {
-    CTextLine *line = lines_[y];
+    const CTextLine *line = lines_[y].get();
 
     const std::string &str = line->getString();
 
@@ -319,7 +324,7 @@ addLineAfter(const std::string &str)
   uint y        = cursor_.getY();
   uint numLines = getNumLines();
 
-  CTextLine *line = allocLine(str);
+  CTextLineP line(allocLine(str));
 
   if (numLines == 0) {
     lines_.push_back(line);
@@ -327,10 +332,10 @@ addLineAfter(const std::string &str)
     notifyMgr_->notifyLineAdded(str, 0);
   }
   else {
-    lines_.push_back(NULL);
+    lines_.push_back(CTextLineP());
 
     for (int i = int(numLines) - 1; i >= int(y + 1); --i)
-      lines_[i + 1] = lines_[i];
+      lines_[i + 1] = std::move(lines_[i]);
 
     lines_[y + 1] = line;
 
@@ -345,7 +350,7 @@ addLineBefore(const std::string &str)
   uint y        = cursor_.getY();
   uint numLines = getNumLines();
 
-  CTextLine *line = allocLine(str);
+  CTextLineP line(allocLine(str));
 
   if (numLines == 0) {
     lines_.push_back(line);
@@ -353,10 +358,10 @@ addLineBefore(const std::string &str)
     notifyMgr_->notifyLineAdded(str, 0);
   }
   else {
-    lines_.push_back(NULL);
+    lines_.push_back(CTextLineP());
 
     for (int i = int(numLines) - 1; i >= int(y); --i)
-      lines_[i + 1] = lines_[i];
+      lines_[i + 1] = std::move(lines_[i]);
 
     lines_[y] = line;
 
@@ -428,17 +433,15 @@ deleteLineAt()
 
   if (y >= numLines) return;
 
-  CTextLine *line = lines_[y];
+  CTextLineP line = lines_[y];
 
-  std::string str = line->getString();
+  const std::string &str = line->getString();
 
   for (int i = int(y); i < int(numLines) - 1; ++i)
-    lines_[i] = lines_[i + 1];
+    lines_[i] = std::move(lines_[i + 1]);
 
   lines_.pop_back();
 
-  oldLines_.push_back(line);
-
   notifyMgr_->notifyLineDeleted(str, y);
 }
 
@@ -451,17 +454,15 @@ deleteLineBefore()
 
   if (y == 0 || y > numLines) return;
 
-  CTextLine *line = lines_[y - 1];
+  CTextLineP line = lines_[y - 1];
 
-  std::string str = line->getString();
+  const std::string &str = line->getString();
 
   for (int i = int(y); i < int(numLines); ++i)
-    lines_[i - 1] = lines_[i];
+    lines_[i - 1] = std::move(lines_[i]);
 
   lines_.pop_back();
 
-  oldLines_.push_back(line);
-
   notifyMgr_->notifyLineDeleted(str, y - 1);
 }
 
@@ -506,6 +507,81 @@ replaceLine(const std::string &str)
   notifyMgr_->notifyLineReplaced(str1, str, y);
 }
 
+void
+CTextFile::
+spliceLines(uint line_num, uint n, const CTextLineList &lines)
+{
+  uint numLines = getNumLines();
+
+  if (line_num > numLines) return;
+
+  n = std::min(n, numLines - line_num);
+
+  LineList::iterator p1 = lines_.begin() + line_num;
+  LineList::iterator p2 = p1 + n;
+
+  LineList oldLines(p1, p2);
+
+  if      (n > lines.size()) {
+    std::copy(lines.begin(), lines.end(), p1);
+
+    lines_.erase(p1 + lines.size(), p2);
+  }
+  else {
+    std::copy(lines.begin(), lines.begin() + n, p1);
+
+    lines_.insert(p2, lines.begin() + n, lines.end());
+  }
+
+  notifyMgr_->notifyLinesSpliced(line_num, oldLines, lines);
+}
+
+CTextLineList
+CTextFile::
+getLines(uint line_num, uint n) const
+{
+  uint numLines = getNumLines();
+
+  if (line_num >= numLines) return CTextLineList();
+
+  n = std::min(n, numLines - line_num);
+
+  return CTextLineList(lines_.begin() + line_num, lines_.begin() + line_num + n);
+}
+
+CTextLineP
+CTextFile::
+createLine(const std::string &str)
+{
+  return CTextLineP(allocLine(str));
+}
+
+CTextFileSnapshot
+CTextFile::
+getSnapshot() const
+{
+  CTextFileSnapshot snapshot;
+
+  snapshot.lines = lines_;
+
+  getPos(&snapshot.x, &snapshot.y);
+
+  return snapshot;
+}
+
+void
+CTextFile::
+restoreSnapshot(const CTextFileSnapshot &snapshot)
+{
+  startGroup();
+
+  spliceLines(0, getNumLines(), snapshot.lines);
+
+  moveTo(snapshot.x, snapshot.y);
+
+  endGroup();
+}
+
 bool
 CTextFile::
 getLine(CTextLine **line)
@@ -519,7 +595,11 @@ getLine(CTextLine **line)
   if (y >= numLines)
     return false;
 
-  *line = lines_[y];
+  // copy on write if line is shared (snapshot, undo, ...)
+  if (lines_[y].use_count() > 1)
+    lines_[y] = std::make_shared<CTextLine>(*lines_[y]);
+
+  *line = lines_[y].get();
 
   return true;
 }
@@ -537,7 +617,7 @@ getLine(const CTextLine **line) const
   if (y >= numLines)
     return false;
 
-  *line = lines_[y];
+  *line = lines_[y].get();
 
   return true;
 }
@@ -556,6 +636,26 @@ endGroup()
   notifyMgr_->notifyEndGroup();
 }
 
+void
+CTextFile::
+startNoUndo()
+{
+  ++noUndoDepth_;
+
+  notifyMgr_->notifyStartNoUndo();
+}
+
+void
+CTextFile::
+endNoUndo()
+{
+  assert(noUndoDepth_ > 0);
+
+  --noUndoDepth_;
+
+  notifyMgr_->notifyEndNoUndo();
+}
+
 CTextFile::LineIterator
 CTextFile::
 beginLine()
@@ -574,16 +674,7 @@ CTextLine *
 CTextFile::
 allocLine(const std::string &str)
 {
-  if (oldLines_.empty())
-    return new CTextLine(str);
-
-  CTextLine *line = oldLines_.back();
-
-  line->setLine(str);
-
-  oldLines_.pop_back();
-
-  return line;
+  return new CTextLine(str);
 }
 
 uint
@@ -810,6 +901,16 @@ notifyCharReplaced(char c1, char c2, uint line_num, uint char_num)
     (*p1)->charReplaced(c1, c2, line_num, char_num);
 }
 
+void
+CTextFileNotifyMgr::
+notifyLinesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1)
+    (*p1)->linesSpliced(line_num, oldLines, newLines);
+}
+
 void
 CTextFileNotifyMgr::
 notifyStartGroup()
@@ -830,6 +931,26 @@ notifyEndGroup()
     (*p1)->endGroup();
 }
 
+void
+CTextFileNotifyMgr::
+notifyStartNoUndo()
+{
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1)
+    (*p1)->startNoUndo();
+}
+
+void
+CTextFileNotifyMgr::
+notifyEndNoUndo()
+{
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1)
+    (*p1)->endNoUndo();
+}
+
 //------
 
 CTextFileNotifier::
@@ -885,6 +1006,12 @@ charReplaced(char, char, uint, uint)
 {
 }
 
+void
+CTextFileNotifier::
+linesSpliced(uint, const CTextLineList &, const CTextLineList &)
+{
+}
+
 void
 CTextFileNotifier::
 startGroup()
@@ -896,3 +1023,15 @@ CTextFileNotifier::
 endGroup()
 {
 }
+
+void
+CTextFileNotifier::
+startNoUndo()
+{
+}
+
+void
+CTextFileNotifier::
+endNoUndo()
+{
+}
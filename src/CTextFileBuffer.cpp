@@ -1,12 +1,17 @@
 #include <CTextFileBuffer.h>
 #include <CTextFile.h>
 #include <CTextFileUtil.h>
+#include <CTextFileSharedBuffer.h>
+#include <algorithm>
 
 CTextFileBuffer::
 CTextFileBuffer(CTextFile *file) :
  file_(file)
 {
   util_ = new CTextFileUtil(file_);
+
+  setShared('+', true);
+  setShared('*', true);
 }
 
 CTextFileBuffer::
@@ -32,15 +37,12 @@ yankLines(char id, uint line_num, uint n)
 {
   yankClear(id);
 
-  for (uint i = 0; i < n; ++i) {
-    uint line_num1 = line_num + i;
-
-    const std::string &line = file_->getLine(line_num1);
+  // reference whole lines (no copy)
+  Buffer &buffer = getBuffer(id);
 
-    uint len = uint(line.size());
+  buffer.addLines(file_->getLines(line_num, n));
 
-    subYankTo(id, line_num1, 0, line_num1, std::max(int(len) - 1, 0), true);
-  }
+  storeShared(id);
 }
 
 void
@@ -124,37 +126,25 @@ void
 CTextFileBuffer::
 subYankTo(char id, uint line_num1, uint char_num1, uint line_num2, uint char_num2, bool is_line)
 {
-  std::vector<BufferLine> lines;
-
-  if      (line_num1 < line_num2) {
-    const std::string &line1 = file_->getLine(line_num1);
-
-    lines.push_back(BufferLine(line1.substr(char_num1), is_line));
-
-    for (uint i = line_num1 + 1; i < line_num2; ++i) {
-      const std::string &line = file_->getLine(i);
-
-      lines.push_back(BufferLine(line, true));
-    }
-
-    const std::string &line2 = file_->getLine(line_num2);
+  Buffer &buffer = getBuffer(id);
 
-    lines.push_back(BufferLine(line2.substr(0, char_num2), is_line));
+  // partial first and last lines are new lines, lines between are referenced
+  if (line_num2 < line_num1) {
+    std::swap(line_num1, line_num2);
+    std::swap(char_num1, char_num2);
   }
-  else if (line_num2 < line_num1) {
-    const std::string &line2 = file_->getLine(line_num2);
 
-    lines.push_back(BufferLine(line2.substr(char_num2), is_line));
+  if (line_num1 < line_num2) {
+    const std::string &line1 = file_->getLine(line_num1);
 
-    for (uint i = line_num2 + 1; i < line_num1; ++i) {
-      const std::string &line = file_->getLine(i);
+    buffer.addLine(file_->createLine(line1.substr(std::min(char_num1, uint(line1.size())))),
+                   is_line);
 
-      lines.push_back(BufferLine(line, true));
-    }
+    buffer.addLines(file_->getLines(line_num1 + 1, line_num2 - line_num1 - 1));
 
-    const std::string &line1 = file_->getLine(line_num1);
+    const std::string &line2 = file_->getLine(line_num2);
 
-    lines.push_back(BufferLine(line1.substr(0, char_num1), is_line));
+    buffer.addLine(file_->createLine(line2.substr(0, char_num2)), is_line);
   }
   else {
     const std::string &line1 = file_->getLine(line_num1);
@@ -166,218 +156,194 @@ subYankTo(char id, uint line_num1, uint char_num1, uint line_num2, uint char_num
     else
       line2 = line1.substr(char_num2, char_num1 - char_num2 + 1);
 
-    lines.push_back(BufferLine(line2, is_line));
+    buffer.addLine(file_->createLine(line2), is_line);
   }
 
-  std::vector<BufferLine>::iterator p1 = lines.begin();
-  std::vector<BufferLine>::iterator p2 = lines.end  ();
+  storeShared(id);
+}
 
-  Buffer &buffer = getBuffer(id);
+void
+CTextFileBuffer::
+pasteAfter(char id, uint count)
+{
+  uint x, y;
 
-  for ( ; p1 != p2; ++p1)
-    buffer.addLine((*p1).line, (*p1).newline);
+  file_->getPos(&x, &y);
+
+  pasteAfter(id, y, x, count);
+}
+
+void
+CTextFileBuffer::
+pasteAfter(char id, uint line_num, uint char_num, uint count)
+{
+  paste(id, line_num, char_num, count, /*after*/true);
 }
 
 void
 CTextFileBuffer::
-pasteAfter(char id)
+pasteBefore(char id, uint count)
 {
   uint x, y;
 
   file_->getPos(&x, &y);
 
-  pasteAfter(id, y, x);
+  pasteBefore(id, y, x, count);
 }
 
 void
 CTextFileBuffer::
-pasteAfter(char id, uint line_num, uint char_num)
+pasteBefore(char id, uint line_num, uint char_num, uint count)
 {
-  Buffer &buffer = getBuffer(id);
+  paste(id, line_num, char_num, count, /*after*/false);
+}
+
+void
+CTextFileBuffer::
+paste(char id, uint line_num, uint char_num, uint count, bool after)
+{
+  loadShared(id);
+
+  const Buffer &buffer = getBuffer(id);
 
-  uint num_lines = uint(buffer.lines.size());
+  uint num_lines = buffer.getNumLines();
 
-  if (num_lines == 0)
+  if (num_lines == 0 || count == 0)
     return;
 
-  BufferLine *sline = &buffer.lines[0];
-  BufferLine *eline = NULL;
+  uint numFileLines = file_->getNumLines();
 
-  if (num_lines > 1)
-    eline = &buffer.lines[num_lines - 1];
+  line_num = std::min(line_num, numFileLines > 0 ? numFileLines - 1 : 0);
 
-  if (! sline->newline) {
-    if (eline)
-      splitLine(line_num, char_num);
+  CTextLineList newLines;
 
-    const std::string &line = file_->getLine(line_num);
+  // whole lines are inserted (shared) after or before line
+  if (buffer.getNewLine(0)) {
+    newLines.reserve(size_t(num_lines)*count);
 
-    if (char_num < line.size())
-      addChars(line_num, char_num + 1, sline->line);
-    else
-      addChars(line_num, char_num, sline->line);
-  }
-  else {
-    ++line_num;
+    for (uint i = 0; i < count; ++i)
+      newLines.insert(newLines.end(), buffer.lines.begin(), buffer.lines.end());
 
-    addLine(line_num, sline->line);
+    uint line_num1 = (after && numFileLines > 0 ? line_num + 1 : line_num);
 
-    file_->rmoveTo(0, 1);
+    file_->spliceLines(line_num1, 0, newLines);
 
-    cursorToLeft();
+    // cursor on last pasted line (after) or first pasted line (before)
+    if (after)
+      file_->moveTo(0, line_num1 + uint(newLines.size()) - 1);
+    else
+      file_->moveTo(0, line_num1);
 
-    ++line_num;
+    return;
   }
 
-  for (uint i = 1; i < num_lines - 1; ++i) {
-    BufferLine *mline = &buffer.lines[i];
-
-    addLine(line_num, mline->line);
+  //---
 
-    file_->rmoveTo(0, 1);
+  // partial first and last lines are joined to the text before and after the paste
+  // position, and whole lines between them are inserted (shared)
+  std::string line = (numFileLines > 0 ? file_->getLine(line_num) : std::string());
 
-    cursorToLeft();
+  uint pos = std::min(char_num, uint(line.size()));
 
-    ++line_num;
-  }
+  if (after && pos < line.size())
+    ++pos;
 
-  if (eline) {
-    if (! eline->newline) {
-      file_->rmoveTo(0, 1);
+  std::string str = line.substr(0, pos);
 
-      cursorToLeft();
+  for (uint i = 0; i < count; ++i) {
+    str += buffer.getLine(0);
 
-      ++line_num;
+    if (num_lines == 1)
+      continue;
 
-      addChars(line_num, 0, eline->line);
-    }
-    else {
-      addLine(line_num, eline->line);
+    newLines.push_back(file_->createLine(str));
 
-      file_->rmoveTo(0, 1);
+    newLines.insert(newLines.end(), buffer.lines.begin() + 1, buffer.lines.end() - 1);
 
-      cursorToLeft();
-    }
+    str = buffer.getLine(num_lines - 1);
   }
-}
 
-void
-CTextFileBuffer::
-pasteBefore(char id)
-{
-  uint x, y;
+  str += line.substr(pos);
 
-  file_->getPos(&x, &y);
+  newLines.push_back(file_->createLine(str));
+
+  file_->spliceLines(line_num, (numFileLines > 0 ? 1 : 0), newLines);
 
-  pasteBefore(id, y, x);
+  // cursor at start of pasted text
+  file_->moveTo(pos, line_num);
 }
 
-void
+bool
 CTextFileBuffer::
-pasteBefore(char id, uint line_num, uint char_num)
+isShared(char id) const
 {
-  Buffer &buffer = getBuffer(id);
-
-  uint num_lines = uint(buffer.lines.size());
-
-  if (num_lines == 0)
-    return;
-
-  BufferLine *sline = &buffer.lines[0];
-  BufferLine *eline = NULL;
-
-  if (num_lines > 1)
-    eline = &buffer.lines[num_lines - 1];
+  BufferMap::const_iterator p = buffer_map_.find(id);
 
-  if (! sline->newline) {
-    if (eline)
-      splitLine(line_num, char_num);
-
-    addChars(line_num, char_num, sline->line);
-  }
-  else
-    addLine(line_num, sline->line);
-
-  for (uint i = 1; i < num_lines - 1; ++i) {
-    BufferLine *mline = &buffer.lines[i];
-
-    addLine(line_num + i, mline->line);
-  }
-
-  if (eline) {
-    if (! eline->newline)
-      addChars(line_num + num_lines - 1, 0, eline->line);
-    else
-      addLine(line_num + num_lines - 1, eline->line);
-  }
+  return (p != buffer_map_.end() && (*p).second.shared);
 }
 
 void
 CTextFileBuffer::
-cursorToLeft()
+setShared(char id, bool shared)
 {
-  uint x, y;
-
-  file_->getPos(&x, &y);
+  Buffer &buffer = getBuffer(id);
 
-  file_->moveTo(0, y);
+  buffer.shared = shared;
+  buffer.seq    = 0;
 }
 
 void
 CTextFileBuffer::
-splitLine(uint line_num, uint char_num)
+storeShared(char id)
 {
-  uint x, y;
-
-  file_->getPos(&x, &y);
-
-  const std::string &line = file_->getLine(line_num);
-
-  std::string line1 = line.substr(0, char_num);
-  std::string line2 = line.substr(char_num);
+  Buffer &buffer = getBuffer(id);
 
-  file_->moveTo(0, line_num);
+  if (! buffer.shared)
+    return;
 
-  file_->replaceLine(line1);
+  // text written once into segment, lines stay shared with file in this instance
+  CTextFileSharedBuffer sharedBuffer(id);
 
-  file_->addLineBefore(line2);
+  buffer.seq = sharedBuffer.write(buffer.lines, buffer.newlines);
 
-  file_->moveTo(x, y);
+  if (buffer.seq == 0)
+    error_ = sharedBuffer.getError();
 }
 
 void
 CTextFileBuffer::
-addChars(uint line_num, uint char_num, const std::string &chars)
+loadShared(char id)
 {
-  uint x, y;
-
-  file_->getPos(&x, &y);
+  Buffer &buffer = getBuffer(id);
 
-  const std::string &line = file_->getLine(line_num);
+  if (! buffer.shared)
+    return;
 
-  file_->moveTo(0, line_num);
+  // only read if changed (e.g. yanked by another instance)
+  CTextFileSharedBuffer sharedBuffer(id);
 
-  std::string line1 = line.substr(0, char_num);
-  std::string line2 = line.substr(char_num);
+  uint64_t seq = sharedBuffer.getSeq();
 
-  file_->replaceLine(line1 + chars + line2);
+  if (seq == 0 && ! sharedBuffer.getError().empty())
+    error_ = sharedBuffer.getError();
 
-  file_->moveTo(x, y);
-}
+  if (seq == 0 || seq == buffer.seq)
+    return;
 
-void
-CTextFileBuffer::
-addLine(uint line_num, const std::string &line)
-{
-  uint x, y;
+  CTextLineList     lines;
+  std::vector<bool> newlines;
 
-  file_->getPos(&x, &y);
+  if (! sharedBuffer.read(file_, lines, newlines, &seq)) {
+    if (! sharedBuffer.getError().empty())
+      error_ = sharedBuffer.getError();
 
-  file_->moveTo(0, line_num);
+    return;
+  }
 
-  file_->addLineBefore(line);
+  buffer.lines   .swap(lines);
+  buffer.newlines.swap(newlines);
 
-  file_->moveTo(x, y);
+  buffer.seq = seq;
 }
 
 CTextFileBuffer::Buffer &
@@ -0,0 +1,114 @@
+#include <CTextFileDryRun.h>
+#include <CTextFileSubst.h>
+#include <CTextFile.h>
+#include <CRegExp.h>
+#include <algorithm>
+
+CTextFileDryRun::
+CTextFileDryRun(CTextFile *file) :
+ file_(file)
+{
+  util_ = new CTextFileUtil(file_);
+}
+
+CTextFileDryRun::
+~CTextFileDryRun()
+{
+  cancel();
+
+  delete util_;
+}
+
+void
+CTextFileDryRun::
+startSubst(uint line_num1, uint line_num2, const std::string &find,
+           const std::string &replace, bool global, bool caseSensitive, uint maxLines)
+{
+  auto subst = std::make_shared<CTextFileSubst>(find, replace, global, caseSensitive);
+
+  start(line_num1, line_num2,
+   [subst, maxLines](const CTextFileSearch &search, uint line_num3, uint line_num4,
+                     Count &count) {
+    return search.countSubst(*subst, line_num3, line_num4, maxLines, count);
+  });
+}
+
+void
+CTextFileDryRun::
+startGlob(uint line_num1, uint line_num2, const std::string &find,
+          bool invert, bool caseSensitive, uint maxLines)
+{
+  // own regexp (cached regexps are used by the GUI thread)
+  auto regexp = std::make_shared<CRegExp>(find);
+
+  regexp->setCaseSensitive(caseSensitive);
+
+  start(line_num1, line_num2,
+   [regexp, invert, maxLines](const CTextFileSearch &search, uint line_num3, uint line_num4,
+                              Count &count) {
+    return search.countLines(*regexp, line_num3, line_num4, invert, maxLines, count);
+  });
+}
+
+const CTextFileDryRun::Count &
+CTextFileDryRun::
+getCount()
+{
+  wait();
+
+  return count_;
+}
+
+void
+CTextFileDryRun::
+cancel()
+{
+  if (! thread_.joinable())
+    return;
+
+  cancel_ = true;
+
+  wait();
+
+  cancel_ = false;
+}
+
+void
+CTextFileDryRun::
+start(uint line_num1, uint line_num2, const CountProc &proc)
+{
+  cancel();
+
+  count_     = Count();
+  cancelled_ = false;
+
+  // lines are copied on write so snapshot lines can be read in the count thread
+  lines_ = file_->getSnapshot().lines;
+
+  if (lines_.empty() || line_num1 > line_num2 || line_num1 >= lines_.size())
+    return;
+
+  line_num2 = std::min(line_num2, uint(lines_.size() - 1));
+
+  done_ = false;
+
+  thread_ = std::thread([this, proc, line_num1, line_num2]() {
+    CTextFileSearch search(&lines_, util_);
+
+    search.setCancel(&cancel_);
+
+    cancelled_ = ! proc(search, line_num1, line_num2, count_);
+
+    done_ = true;
+  });
+}
+
+void
+CTextFileDryRun::
+wait()
+{
+  if (thread_.joinable())
+    thread_.join();
+
+  lines_.clear();
+}
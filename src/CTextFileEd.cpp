@@ -1,14 +1,25 @@
 #include <CTextFileEd.h>
 #include <CTextFile.h>
 #include <CTextFileUtil.h>
+#include <CTextFileDryRun.h>
+#include <CTextFileEdScript.h>
+#include <CTextFileFilter.h>
 #include <CTextFileMarks.h>
 #include <CTextFileUndo.h>
+#include <CTextFileRegExpCache.h>
+#include <CTextFileGlobMarks.h>
+#include <CTextFileSearch.h>
+#include <CTextFileSort.h>
+#include <CTextFileSubst.h>
+#include <CTextFileTrigramIndex.h>
 #include <COptVal.h>
 #include <CFile.h>
 #include <CRegExp.h>
 #include <CStrUtil.h>
 #include <CStrParse.h>
 #include <CCommand.h>
+#include <cctype>
+#include <cstring>
 
 CTextFileEd::
 CTextFileEd(CTextFile *file) :
@@ -25,7 +36,11 @@ CTextFileEd(CTextFile *file) :
  findPattern_   (),
  ex_            (false),
  case_sensitive_(true),
- quit_          (false)
+ glob_          (false),
+ quit_          (false),
+ dryRun_        (NULL),
+ dryRunPending_ (false),
+ dryRunSubst_   (false)
 {
   util_  = new CTextFileUtil(file);
   marks_ = new CTextFileMarks(file);
@@ -37,6 +52,7 @@ CTextFileEd(CTextFile *file) :
 CTextFileEd::
 ~CTextFileEd()
 {
+  delete dryRun_;
   delete util_;
   delete marks_;
   delete undo_;
@@ -88,26 +104,18 @@ bool
 CTextFileEd::
 execFile(const std::string &fileName)
 {
-  std::vector<std::string> lines;
+  // compile whole script before running it
+  CTextFileEdScript script(case_sensitive_);
 
-  CFile file(fileName);
+  script.setEx(getEx());
 
-  if (! file.exists() || ! file.isRegular())
+  if (! script.compileFile(fileName)) {
+    error(script.getError());
     return false;
-
-  file.toLines(lines);
-
-  std::vector<std::string>::const_iterator p1, p2;
-
-  for (p1 = lines.begin(), p2 = lines.end(); p1 != p2; ++p1) {
-    std::string line = CStrUtil::stripSpaces(*p1);
-
-    if (line.empty() || line[0] == '#')
-      continue;
-
-    execCmd(line);
   }
 
+  script.exec(this);
+
   return true;
 }
 
@@ -156,72 +164,51 @@ execCmd(const std::string &cmd)
 
   CStrParse parse(cmd);
 
-  num_lines_ = 0;
-
-  bool has_range = false;
-  int  line_num, char_num;
-  bool all;
-
-  while (parseLineNum(parse, line_num, char_num, all)) {
-    has_range = true;
-
-    if (all) {
-      num_lines_ = 2;
-
-      line_num1_ =                    1; char_num1_ = 0;
-      line_num2_ = file_->getNumLines(); char_num2_ = 0;
+  CTextFileEdAddrs addrs;
+  std::string      msg;
 
-      break;
-    }
+  if (! parseRange(parse, getEx(), addrs, msg)) {
+    error(msg);
+    return false;
+  }
 
-    ++num_lines_;
+  if (! evalRange(addrs))
+    return false;
 
-    line_num1_ = line_num2_;
-    char_num1_ = char_num2_;
+  //-----
 
-    line_num2_ = line_num;
-    char_num2_ = char_num;
+  parse.skipSpace();
 
-    if (! parse.isChar(',') && ! parse.isChar(';'))
-      break;
+  if (! parseCmd(parse))
+    return false;
 
-    if (parse.isChar(';'))
-      cur_line_ = line_num;
+  //setPos(CIPoint2D(0, line_num2_ - 1));
 
-    parse.skipChar();
-  }
+  return true;
+}
 
-  //-----
+bool
+CTextFileEd::
+execCmd(const CTextFileEdCmd &cmd)
+{
+  if (mode_ == INPUT || cmd.text)
+    return execCmd(cmd.line);
 
-  if (has_range) {
-    if (num_lines_ == 0) {
-      line_num2_ = cur_line_;
-      char_num2_ = 0;
-    }
+  if (! evalRange(cmd.addrs))
+    return false;
 
-    if (num_lines_ <= 1) {
-      line_num1_ = line_num2_;
-      char_num1_ = char_num2_;
-    }
+  // use compiled patterns if available
+  if      (cmd.subst)
+    doSubstitute(line_num1_, line_num2_, *cmd.subst);
+  else if (cmd.regexp)
+    doGlob(line_num1_, line_num2_, *cmd.regexp, cmd.invert, *cmd.cmd);
+  else {
+    CStrParse parse(cmd.body);
 
-    // ensure valid range
-    if (line_num1_ < 1 || line_num1_ > int(file_->getNumLines() + 1) ||
-        line_num2_ < 1 || line_num2_ > int(file_->getNumLines() + 1)) {
-      error("Invalid range: " + CStrUtil::toString(line_num1_) +
-            " to " + CStrUtil::toString(line_num2_));
+    if (! parseCmd(parse))
       return false;
-    }
   }
 
-  //-----
-
-  parse.skipSpace();
-
-  if (! parseCmd(parse))
-    return false;
-
-  //setPos(CIPoint2D(0, line_num2_ - 1));
-
   return true;
 }
 
@@ -249,6 +236,19 @@ parseCmd(CStrParse &parse)
       break;
     }
     case 'd': { // (.,.)d - delete line
+      // (%)dedupe - delete lines equal to an earlier line (whole file if no range)
+      if (isNamedCmd("d" + parse.getAt(), "dedupe")) {
+        if (! parseNamedCmdEnd(parse, "dedupe"))
+          return false;
+
+        if (! setWholeFileRange("dedupe"))
+          return false;
+
+        doUniq(line_num1_, line_num2_, /*adjacent*/false);
+
+        break;
+      }
+
       doDelete(line_num1_, line_num2_);
 
       break;
@@ -322,7 +322,16 @@ parseCmd(CStrParse &parse)
 
       break;
     }
-    case 'g': { // (.,.)g/<regexp>/<cmd>... - apply cmds to matching lines
+    case 'g':   // (.,.)g[!]/<regexp>/<cmd>... - apply cmds to matching lines
+    case 'v': { // (.,.)v/<regexp>/<cmd>... - apply cmds to non-matching lines
+      bool invert = (c == 'v');
+
+      if (c == 'g' && parse.isChar('!')) {
+        parse.skipChar();
+
+        invert = true;
+      }
+
       // read separator char
       char sep;
 
@@ -349,21 +358,21 @@ parseCmd(CStrParse &parse)
       if (parse.isChar(sep))
         parse.skipChar();
 
-      // get command
-      std::string cmd = "p";
+      // get command (rest of line)
+      parse.skipSpace();
 
-      while (! parse.eof()) {
-        parse.readString(cmd);
+      std::string cmd = parse.getAt();
 
-        parse.skipSpace();
-      }
+      if (cmd.empty())
+        cmd = "p";
 
-      if (! parse.eof()) {
-        error("Trailing characters");
-        return false;
+      // count lines only (dry run)
+      if (isNamedCmd(cmd, "count") && cmd.size() == 5) {
+        doGlobCount(line_num1_, line_num2_, find, invert);
+        break;
       }
 
-      doGlob(line_num1_, line_num2_, find, cmd);
+      doGlob(line_num1_, line_num2_, find, cmd, invert);
 
       break;
     }
@@ -517,6 +526,53 @@ parseCmd(CStrParse &parse)
       break;
     }
     case 's': { // (.,.)s[/<regexp>/<replace>/[g|<n>]] - substitute
+      // (%)sort [n][u][r][i] [/<regexp>/] - sort lines (whole file if no range)
+      if (isNamedCmd("s" + parse.getAt(), "sort")) {
+        for (int i = 0; i < 3; ++i)
+          parse.skipChar();
+
+        std::string opts, pattern;
+
+        while (! parse.eof()) {
+          parse.skipSpace();
+
+          char c1;
+
+          if (! parse.readChar(&c1))
+            break;
+
+          if      (strchr("nuri", c1))
+            opts += c1;
+          else if (c1 == '/') {
+            while (! parse.eof() && ! parse.isChar('/')) {
+              char c2;
+
+              parse.readChar(&c2);
+
+              pattern += c2;
+            }
+
+            if (parse.isChar('/'))
+              parse.skipChar();
+
+            // use previous find if empty
+            if (pattern.empty())
+              pattern = getFindPattern();
+          }
+          else {
+            error(std::string("Invalid sort argument: ") + c1);
+            return false;
+          }
+        }
+
+        if (! setWholeFileRange("sort"))
+          return false;
+
+        doSort(line_num1_, line_num2_, opts, pattern);
+
+        break;
+      }
+
       // read separator char
       char sep;
 
@@ -553,14 +609,21 @@ parseCmd(CStrParse &parse)
       if (parse.isChar(sep))
         parse.skipChar();
 
-      // get optional modifier char
+      // get optional flags (g - all matches in line, n - count only)
       // TODO: support <n>
-      char mod = '\0';
+      char mod   = '\0';
+      bool count = false;
+
+      while (! parse.eof() && ! parse.isSpace()) {
+        char c1;
 
-      if (! parse.eof()) {
-        parse.readChar(&mod);
+        parse.readChar(&c1);
 
-        if (mod != 'g')
+        if      (c1 == 'g')
+          mod = c1;
+        else if (c1 == 'n')
+          count = true;
+        else
           return false;
       }
 
@@ -569,7 +632,10 @@ parseCmd(CStrParse &parse)
       if (! parse.eof())
         return false;
 
-      doSubstitute(line_num1_, line_num2_, find, replace, mod);
+      if (count)
+        doSubstituteCount(line_num1_, line_num2_, find, replace, mod);
+      else
+        doSubstitute(line_num1_, line_num2_, find, replace, mod);
 
       break;
     }
@@ -607,14 +673,23 @@ parseCmd(CStrParse &parse)
       break;
     }
     case 'u': { // u - undo
+      // (%)uniq - delete lines equal to previous line (whole file if no range)
+      if (isNamedCmd("u" + parse.getAt(), "uniq")) {
+        if (! parseNamedCmdEnd(parse, "uniq"))
+          return false;
+
+        if (! setWholeFileRange("uniq"))
+          return false;
+
+        doUniq(line_num1_, line_num2_, /*adjacent*/true);
+
+        break;
+      }
+
       doUndo();
 
       break;
     }
-    case 'v': { // (.,.)v/<regexp>/<cmd>... - apply cmds to non-matching lines
-      error("v: Unimplemented");
-      break;
-    }
     case 'V': { // (.,.)V/<regexp>/ - edit each non-matching line
       error("V: Unimplemented");
       break;
@@ -743,11 +818,108 @@ parseCmd(CStrParse &parse)
 
 bool
 CTextFileEd::
-parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
+parseNamedCmdEnd(CStrParse &parse, const std::string &name)
 {
-  line_num = cur_line_;
-  char_num = 0;
-  all      = false;
+  // skip rest of name and check no arguments
+  for (uint i = 1; i < name.size(); ++i)
+    parse.skipChar();
+
+  parse.skipSpace();
+
+  if (! parse.eof()) {
+    error("Invalid " + name + " argument: " + parse.getAt());
+    return false;
+  }
+
+  return true;
+}
+
+bool
+CTextFileEd::
+setWholeFileRange(const std::string &name)
+{
+  // commands on whole file default to all lines when no range given
+  if (num_lines_ == 0) {
+    // in global this would run on the whole file for each marked line
+    if (glob_) {
+      error(name + " needs a range in global");
+      return false;
+    }
+
+    line_num1_ = 1;
+    line_num2_ = int(file_->getNumLines());
+  }
+
+  return true;
+}
+
+bool
+CTextFileEd::
+isNamedCmd(const std::string &cmd, const std::string &name)
+{
+  // name not followed by a letter (e.g. sort, not s followed by a separator)
+  size_t len = name.size();
+
+  return (cmd.compare(0, len, name) == 0 && (cmd.size() == len || ! isalpha(cmd[len])));
+}
+
+bool
+CTextFileEd::
+parseRange(CStrParse &parse, bool ex, CTextFileEdAddrs &addrs, std::string &msg)
+{
+  addrs.clear();
+
+  msg = "";
+
+  CTextFileEdAddr addr;
+
+  while (parseAddr(parse, ex, addr, msg)) {
+    if (addr.type == CTextFileEdAddr::Type::ALL) {
+      addrs.push_back(addr);
+      break;
+    }
+
+    if (! parse.isChar(',') && ! parse.isChar(';')) {
+      addrs.push_back(addr);
+      break;
+    }
+
+    addr.sep = parse.getCharAt();
+
+    parse.skipChar();
+
+    addrs.push_back(addr);
+  }
+
+  return msg.empty();
+}
+
+bool
+CTextFileEd::
+parseAddr(CStrParse &parse, bool ex, CTextFileEdAddr &addr, std::string &msg)
+{
+  addr = CTextFileEdAddr();
+
+  // read offsets (+<n> or -<n>)
+  auto parseOffsets = [&]() {
+    while (parse.isChar('+') || parse.isChar('-')) {
+      int s = (parse.isChar('+') ? 1 : -1);
+
+      parse.skipChar();
+
+      parse.skipSpace();
+
+      int d = 0;
+
+      if (parse.isDigit()) {
+        parse.readInteger(&d);
+
+        parse.skipSpace();
+      }
+
+      addr.offset += d*s;
+    }
+  };
 
   parse.skipSpace();
 
@@ -773,7 +945,8 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
       }
     }
 
-    line_num = cur_line_ + d;
+    addr.type   = CTextFileEdAddr::Type::CURRENT;
+    addr.offset = d;
 
     return true;
   }
@@ -799,7 +972,8 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
       }
     }
 
-    line_num = cur_line_ - d;
+    addr.type   = CTextFileEdAddr::Type::CURRENT;
+    addr.offset = -d;
 
     return true;
   }
@@ -811,25 +985,10 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
 
     parse.skipSpace();
 
-    line_num = i;
-
-    while (parse.isChar('+') || parse.isChar('-')) {
-      int s = (parse.isChar('+') ? 1 : -1);
-
-      parse.skipChar();
-
-      parse.skipSpace();
-
-      int d = 0;
-
-      if (parse.isDigit()) {
-        parse.readInteger(&d);
-
-        parse.skipSpace();
-      }
+    addr.type = CTextFileEdAddr::Type::LINE;
+    addr.line = i;
 
-      line_num += d*s;
-    }
+    parseOffsets();
 
     return true;
   }
@@ -839,26 +998,9 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
 
     parse.skipSpace();
 
-    line_num = cur_line_;
-
-    // offset
-    while (parse.isChar('+') || parse.isChar('-')) {
-      int s = (parse.isChar('+') ? 1 : -1);
-
-      parse.skipChar();
-
-      parse.skipSpace();
-
-      int d = 0;
-
-      if (parse.isDigit()) {
-        parse.readInteger(&d);
-
-        parse.skipSpace();
-      }
+    addr.type = CTextFileEdAddr::Type::CURRENT;
 
-      line_num += d*s;
-    }
+    parseOffsets();
 
     return true;
   }
@@ -868,26 +1010,9 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
 
     parse.skipSpace();
 
-    line_num = file_->getNumLines();
-
-    // offset
-    while (parse.isChar('+') || parse.isChar('-')) {
-      int s = (parse.isChar('+') ? 1 : -1);
-
-      parse.skipChar();
-
-      parse.skipSpace();
-
-      int d = 0;
-
-      if (parse.isDigit()) {
-        parse.readInteger(&d);
-
-        parse.skipSpace();
-      }
+    addr.type = CTextFileEdAddr::Type::LAST;
 
-      line_num += d*s;
-    }
+    parseOffsets();
 
     return true;
   }
@@ -895,20 +1020,12 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
   else if (parse.isChar('\'')) {
     parse.skipChar();
 
-    char c;
-
-    if (! parse.readChar(&c))
-      return true;
-
-    uint line_num1, char_num1;
+    addr.type = CTextFileEdAddr::Type::MARK;
 
-    if (! getMarks()->getMarkPos(std::string(&c, 1), &line_num1, &char_num1)) {
-      error("Mark not set");
-      return false;
-    }
+    char c;
 
-    line_num = line_num1 + 1;
-    char_num = char_num1 + 1;
+    if (parse.readChar(&c))
+      addr.mark = c;
 
     return true;
   }
@@ -916,9 +1033,7 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
   else if (parse.isChar('%')) {
     parse.skipChar();
 
-    line_num = 1;
-
-    all = true;
+    addr.type = CTextFileEdAddr::Type::ALL;
 
     return true;
   }
@@ -940,27 +1055,16 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
         str += c;
     }
 
-    if (parse.eof() && ! getEx()) {
-      error("Missing terminating '" + std::string(&sc, 1) + "'");
+    if (parse.eof() && ! ex) {
+      msg = "Missing terminating '" + std::string(&sc, 1) + "'";
       return false;
     }
 
     parse.skipChar();
 
-    int fline_num, fchar_num;
-
-    if (sc == '/') {
-      if (findNext(str, &fline_num, &fchar_num)) {
-        line_num = fline_num;
-        char_num = fchar_num;
-      }
-    }
-    else {
-      if (findPrev(str, &fline_num, &fchar_num)) {
-        line_num = fline_num;
-        char_num = fchar_num;
-      }
-    }
+    addr.type    = (sc == '/' ? CTextFileEdAddr::Type::FIND_NEXT :
+                                CTextFileEdAddr::Type::FIND_PREV);
+    addr.pattern = str;
 
     return true;
   }
@@ -968,20 +1072,183 @@ parseLineNum(CStrParse &parse, int &line_num, int &char_num, bool &all)
     return false;
 }
 
+bool
+CTextFileEd::
+evalRange(const CTextFileEdAddrs &addrs)
+{
+  num_lines_ = 0;
+
+  bool has_range = false;
+  int  line_num, char_num;
+  bool all;
+
+  for (const auto &addr : addrs) {
+    if (! evalAddr(addr, line_num, char_num, all))
+      return false;
+
+    has_range = true;
+
+    if (all) {
+      num_lines_ = 2;
+
+      line_num1_ =                    1; char_num1_ = 0;
+      line_num2_ = file_->getNumLines(); char_num2_ = 0;
+
+      break;
+    }
+
+    ++num_lines_;
+
+    line_num1_ = line_num2_;
+    char_num1_ = char_num2_;
+
+    line_num2_ = line_num;
+    char_num2_ = char_num;
+
+    if (addr.sep == ';')
+      cur_line_ = line_num;
+  }
+
+  //-----
+
+  if (has_range) {
+    if (num_lines_ == 0) {
+      line_num2_ = cur_line_;
+      char_num2_ = 0;
+    }
+
+    if (num_lines_ <= 1) {
+      line_num1_ = line_num2_;
+      char_num1_ = char_num2_;
+    }
+
+    // ensure valid range
+    if (line_num1_ < 1 || line_num1_ > int(file_->getNumLines() + 1) ||
+        line_num2_ < 1 || line_num2_ > int(file_->getNumLines() + 1)) {
+      error("Invalid range: " + CStrUtil::toString(line_num1_) +
+            " to " + CStrUtil::toString(line_num2_));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+CTextFileEd::
+evalAddr(const CTextFileEdAddr &addr, int &line_num, int &char_num, bool &all)
+{
+  line_num = cur_line_;
+  char_num = 0;
+  all      = false;
+
+  switch (addr.type) {
+    case CTextFileEdAddr::Type::LINE:
+      line_num = addr.line + addr.offset;
+      break;
+    case CTextFileEdAddr::Type::CURRENT:
+      line_num = cur_line_ + addr.offset;
+      break;
+    case CTextFileEdAddr::Type::LAST:
+      line_num = int(file_->getNumLines()) + addr.offset;
+      break;
+    case CTextFileEdAddr::Type::MARK: {
+      if (addr.mark == '\0')
+        break;
+
+      uint line_num1, char_num1;
+
+      if (! getMarks()->getMarkPos(std::string(&addr.mark, 1), &line_num1, &char_num1)) {
+        error("Mark not set");
+        return false;
+      }
+
+      line_num = line_num1 + 1;
+      char_num = char_num1 + 1;
+
+      break;
+    }
+    case CTextFileEdAddr::Type::ALL:
+      line_num = 1;
+      all      = true;
+      break;
+    case CTextFileEdAddr::Type::FIND_NEXT:
+    case CTextFileEdAddr::Type::FIND_PREV: {
+      int fline_num, fchar_num;
+
+      bool found;
+
+      // pre-compiled regexp (see CTextFileEdScript) or pattern
+      if      (addr.regexp) {
+        if (addr.type == CTextFileEdAddr::Type::FIND_NEXT)
+          found = findNext(*addr.regexp, &fline_num, &fchar_num);
+        else
+          found = findPrev(*addr.regexp, &fline_num, &fchar_num);
+      }
+      else {
+        if (addr.type == CTextFileEdAddr::Type::FIND_NEXT)
+          found = findNext(addr.pattern, &fline_num, &fchar_num);
+        else
+          found = findPrev(addr.pattern, &fline_num, &fchar_num);
+      }
+
+      if (found) {
+        line_num = fline_num;
+        char_num = fchar_num;
+      }
+
+      break;
+    }
+    default:
+      break;
+  }
+
+  return true;
+}
+
 bool
 CTextFileEd::
 findNext(const std::string &str, int *line_num, int *char_num)
 {
-  CRegExp regexp(str);
+  // literal patterns (including case insensitive) use the literal search
+  if (CTextFileUtil::isLiteralPattern(str)) {
+    auto proc = [&](uint line_num1, int char_num1, int line_num2, int char_num2,
+                    uint *fline_num, uint *fchar_num) {
+      return util_->findNext(str, line_num1, char_num1, line_num2, char_num2,
+                             fline_num, fchar_num, case_sensitive_);
+    };
+
+    return findNextProc(proc, line_num, char_num);
+  }
+
+  CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(str, case_sensitive_);
 
-  regexp.setCaseSensitive(case_sensitive_);
+  return findNext(*regexp, line_num, char_num);
+}
+
+bool
+CTextFileEd::
+findNext(const CRegExp &regexp, int *line_num, int *char_num)
+{
+  auto proc = [&](uint line_num1, int char_num1, int line_num2, int char_num2,
+                  uint *fline_num, uint *fchar_num) {
+    return util_->findNext(regexp, line_num1, char_num1, line_num2, char_num2,
+                           fline_num, fchar_num, NULL);
+  };
 
+  return findNextProc(proc, line_num, char_num);
+}
+
+bool
+CTextFileEd::
+findNextProc(const FindProc &proc, int *line_num, int *char_num)
+{
   uint fline_num, fchar_num;
 
   uint num_lines = file_->getNumLines();
 
   if (! getEx() && cur_line_ >= int(num_lines)) {
-    if (util_->findNext(regexp, 0, 0, num_lines - 1, -1, &fline_num, &fchar_num, NULL)) {
+    if (proc(0, 0, num_lines - 1, -1, &fline_num, &fchar_num)) {
       *line_num = fline_num + 1;
       *char_num = fchar_num;
       return true;
@@ -1005,8 +1272,8 @@ findNext(const std::string &str, int *line_num, int *char_num)
     col2 = -1;
   }
 
-  if (util_->findNext(regexp, row1, col1, num_lines - 1, -1, &fline_num, &fchar_num, NULL) ||
-      util_->findNext(regexp, 0, 0, row2, col2, &fline_num, &fchar_num, NULL)) {
+  if (proc(row1, col1, num_lines - 1, -1, &fline_num, &fchar_num) ||
+      proc(0, 0, row2, col2, &fline_num, &fchar_num)) {
     *line_num = fline_num + 1;
     *char_num = fchar_num;
     return true;
@@ -1019,16 +1286,45 @@ bool
 CTextFileEd::
 findPrev(const std::string &str, int *line_num, int *char_num)
 {
-  CRegExp regexp(str);
+  // literal patterns (including case insensitive) use the literal search
+  if (CTextFileUtil::isLiteralPattern(str)) {
+    auto proc = [&](uint line_num1, int char_num1, int line_num2, int char_num2,
+                    uint *fline_num, uint *fchar_num) {
+      return util_->findPrev(str, line_num1, char_num1, line_num2, char_num2,
+                             fline_num, fchar_num, case_sensitive_);
+    };
+
+    return findPrevProc(proc, line_num, char_num);
+  }
+
+  CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(str, case_sensitive_);
 
-  regexp.setCaseSensitive(case_sensitive_);
+  return findPrev(*regexp, line_num, char_num);
+}
+
+bool
+CTextFileEd::
+findPrev(const CRegExp &regexp, int *line_num, int *char_num)
+{
+  auto proc = [&](uint line_num1, int char_num1, int line_num2, int char_num2,
+                  uint *fline_num, uint *fchar_num) {
+    return util_->findPrev(regexp, line_num1, char_num1, line_num2, char_num2,
+                           fline_num, fchar_num, NULL);
+  };
 
+  return findPrevProc(proc, line_num, char_num);
+}
+
+bool
+CTextFileEd::
+findPrevProc(const FindProc &proc, int *line_num, int *char_num)
+{
   uint fline_num, fchar_num;
 
   uint num_lines = file_->getNumLines();
 
   if (! getEx() && cur_line_ == 0) {
-    if (util_->findPrev(regexp, num_lines - 1, -1, 0, 0, &fline_num, &fchar_num, NULL)) {
+    if (proc(num_lines - 1, -1, 0, 0, &fline_num, &fchar_num)) {
       *line_num = fline_num + 1;
       *char_num = fchar_num;
       return true;
@@ -1048,12 +1344,12 @@ findPrev(const std::string &str, int *line_num, int *char_num)
   else {
     row1 = cur_line_ - 1;
     col1 = -1;
-    row1 = cur_line_;
-    col1 = 0;
+    row2 = cur_line_;
+    col2 = 0;
   }
 
-  if (util_->findPrev(regexp, row1, col1, 0, 0, &fline_num, &fchar_num, NULL) ||
-      util_->findPrev(regexp, num_lines - 1, -1, row2, col2, &fline_num, &fchar_num, NULL)) {
+  if (proc(row1, col1, 0, 0, &fline_num, &fchar_num) ||
+      proc(num_lines - 1, -1, row2, col2, &fline_num, &fchar_num)) {
     *line_num = fline_num + 1;
     *char_num = fchar_num;
     return true;
@@ -1069,146 +1365,337 @@ doSubstitute(int line_num1, int line_num2, const std::string &find,
 {
   bool global = (mod == 'g');
 
-  file_->startGroup();
+  CTextFileSubst subst(find, replace, global, case_sensitive_);
+
+  doSubstitute(line_num1, line_num2, subst);
+}
 
-  CRegExp regexp(find);
+void
+CTextFileEd::
+doSubstitute(int line_num1, int line_num2, const CTextFileSubst &subst)
+{
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
 
-  regexp.setCaseSensitive(case_sensitive_);
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
 
-  for (int i = line_num1; i <= line_num2; ++i) {
-    uint fline_num, fchar_num, len;
+  CTextFileTrigramSig sig;
 
-    if (util_->findNext(regexp, i - 1, 0, i - 1, -1, &fline_num, &fchar_num, &len)) {
-      int spos = fchar_num;
-      int epos = spos + len - 1;
+  const CTextFileTrigramIndex *index = util_->getSearchIndex(subst.getFind(), true, sig);
 
-      util_->replace(i - 1, spos, epos, replace);
+  // build all changed lines (in parallel for large ranges) then apply them together
+  CTextFileSearch search(file_, util_);
 
-      if (global) {
-        while (util_->findNext(regexp, i - 1, epos + 1, i - 1, -1, &fline_num, &fchar_num, &len)) {
-          int spos1 = fchar_num;
-          int epos1 = spos1 + len - 1;
+  search.setIndex(index, &sig);
 
-          util_->replace(i - 1, spos1, epos1, replace);
-        }
-      }
-    }
-  }
+  CTextFileUtil::LineEdits edits;
+
+  search.substLines(subst, line_num1 - 1, line_num2 - 1, edits);
+
+  if (edits.empty())
+    return;
+
+  file_->startGroup();
+
+  uint line_num = util_->replaceLines(edits);
 
   file_->endGroup();
+
+  setPos(CIPoint2D(0, int(line_num)));
 }
 
 void
 CTextFileEd::
-doFindNext(int line_num1, int line_num2, const std::string &find)
+doSubstituteCount(int line_num1, int line_num2, const std::string &find,
+                  const std::string &replace, char mod)
+{
+  bool global = (mod == 'g');
+
+  if (! dryRun_)
+    dryRun_ = new CTextFileDryRun(file_);
+
+  // count is reported when finished (see pollDryRun)
+  dryRun_->startSubst(line_num1 - 1, line_num2 - 1, find, replace, global, case_sensitive_);
+
+  dryRunPending_ = true;
+  dryRunSubst_   = true;
+}
+
+void
+CTextFileEd::
+doGlobCount(int line_num1, int line_num2, const std::string &find, bool invert)
 {
-  CRegExp regexp(find);
+  if (! dryRun_)
+    dryRun_ = new CTextFileDryRun(file_);
 
-  regexp.setCaseSensitive(case_sensitive_);
+  // count is reported when finished (see pollDryRun)
+  dryRun_->startGlob(line_num1 - 1, line_num2 - 1, find, invert, case_sensitive_);
+
+  dryRunPending_ = true;
+  dryRunSubst_   = false;
+}
+
+bool
+CTextFileEd::
+isDryRunPending() const
+{
+  return dryRunPending_;
+}
+
+bool
+CTextFileEd::
+pollDryRun(bool wait)
+{
+  if (! dryRunPending_)
+    return true;
+
+  if (! wait && ! dryRun_->isDone())
+    return false;
+
+  dryRunPending_ = false;
+
+  const CTextFileDryRun::Count &count = dryRun_->getCount();
+
+  if (dryRun_->isCancelled())
+    return true;
+
+  std::string msg;
+
+  if (dryRunSubst_)
+    msg = CStrUtil::toString(count.numMatches) + " matches on " +
+          CStrUtil::toString(count.numLines) + " lines";
+  else
+    msg = CStrUtil::toString(count.numLines) + " lines";
+
+  if (! edNotifyCount(count.numMatches, count.numLines, msg))
+    output(msg);
+
+  return true;
+}
+
+void
+CTextFileEd::
+doFindNext(int line_num1, int line_num2, const std::string &find)
+{
+  CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(find, case_sensitive_);
 
   uint fline_num, fchar_num;
 
-  util_->findNext(regexp, line_num1 - 1, 0, line_num2 - 1, -1, &fline_num, &fchar_num, NULL);
+  util_->findNext(*regexp, line_num1 - 1, 0, line_num2 - 1, -1, &fline_num, &fchar_num, NULL);
 }
 
 void
 CTextFileEd::
 doFindPrev(int line_num1, int line_num2, const std::string &find)
 {
-  CRegExp regexp(find);
-
-  regexp.setCaseSensitive(case_sensitive_);
+  CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(find, case_sensitive_);
 
   uint fline_num, fchar_num;
 
-  util_->findPrev(regexp, line_num1 - 1, -1, line_num2 - 1, 0, &fline_num, &fchar_num, NULL);
+  util_->findPrev(*regexp, line_num1 - 1, -1, line_num2 - 1, 0, &fline_num, &fchar_num, NULL);
+}
+
+void
+CTextFileEd::
+doGlob(int line_num1, int line_num2, const std::string &find, const std::string &cmd,
+       bool invert)
+{
+  // parse command once for all marked lines
+  CTextFileEdCmd cmd1;
+  std::string    msg;
+
+  if (! CTextFileEdScript::compileCmd(cmd, case_sensitive_, getEx(), cmd1, msg)) {
+    error(msg);
+    return;
+  }
+
+  CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(find, case_sensitive_);
+
+  doGlob(line_num1, line_num2, *regexp, invert, cmd1);
 }
 
 void
 CTextFileEd::
-doGlob(int line_num1, int line_num2, const std::string &find, const std::string &cmd)
+doGlob(int line_num1, int line_num2, const CRegExp &regexp, bool invert,
+       const CTextFileEdCmd &cmd)
 {
+  if (glob_) {
+    error("Cannot do global recursively");
+    return;
+  }
+
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
+
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  CTextFileTrigramSig sig;
+
+  const CTextFileTrigramIndex *index = util_->getSearchIndex(regexp.getPattern(), true, sig);
+
+  // mark matching lines (in parallel for large ranges)
+  CTextFileSearch search(file_, util_);
+
+  search.setIndex(index, &sig);
+
+  CTextFileSearch::LineNums lines;
+
+  search.matchLines(regexp, line_num1 - 1, line_num2 - 1, invert, lines);
+
+  if (lines.empty())
+    return;
+
+  // print and delete only affect the marked lines so are done for all marks at once
+  bool noRange = cmd.addrs.empty();
+
+  if      (noRange && cmd.body == "p") {
+    for (uint line_num : lines)
+      printLine(line_num, /*numbered*/false, /*eol*/false);
+
+    flushOutput();
+
+    setPos(CIPoint2D(0, int(lines.back())));
+
+    return;
+  }
+  else if (noRange && cmd.body == "d") {
+    file_->startGroup();
+
+    util_->deleteLines(lines);
+
+    file_->endGroup();
+
+    int line_num = int(lines.back()) - int(lines.size()) + 1;
+
+    setPos(CIPoint2D(0, std::min(line_num, int(file_->getNumLines()) - 1)));
+
+    return;
+  }
+
+  // run command on each marked line (marks move with edits)
+  CTextFileGlobMarks marks(file_, lines);
+
+  glob_ = true;
+
   file_->startGroup();
 
-  CRegExp regexp(find);
+  uint line_num;
 
-  regexp.setCaseSensitive(case_sensitive_);
+  while (marks.nextMark(&line_num)) {
+    setPos(CIPoint2D(0, int(line_num)));
 
-  for (int i = line_num1; i <= line_num2; ++i) {
-    const std::string &line = file_->getLine(i - 1);
+    line_num1_ = cur_line_;
+    line_num2_ = cur_line_;
 
-    if (! util_->lineFindNext(line, regexp, 0, -1, NULL, NULL))
-      continue;
+    if (! execCmd(cmd))
+      break;
+
+    if (mode_ == INPUT) {
+      mode_ = COMMAND;
+
+      input_data_.clearLines();
+
+      error("Input mode not supported in global");
 
-    if      (cmd == "d")
-      deleteLine(--i);
-    else if (cmd == "p")
-      output(line);
-    else {
-      error("Not an editor command: " + cmd);
       break;
     }
   }
 
   file_->endGroup();
+
+  glob_ = false;
 }
 
 void
 CTextFileEd::
 doJoin(int line_num1, int line_num2)
 {
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
+
+  if (line_num1 < 1 || line_num2 <= line_num1)
+    return;
+
+  // one splice for whole range
   file_->startGroup();
 
-  for (int i = line_num1; i < line_num2; ++i)
-    util_->joinLine(line_num1 - 1);
+  util_->joinLines(uint(line_num1 - 1), uint(line_num2 - 1));
 
   file_->endGroup();
+
+  setPos(CIPoint2D(0, line_num1 - 1));
 }
 
 void
 CTextFileEd::
 doMove(int line_num1, int line_num2, int line_num3)
 {
-  file_->startGroup();
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
 
-  if      (line_num3 < line_num1) {
-    for (int i = line_num2; i >= line_num1; --i)
-      util_->moveLine(i - 1, line_num3 - 1);
-  }
-  else if (line_num3 > line_num2) {
-    for (int i = line_num1; i <= line_num2; ++i)
-      util_->moveLine(line_num1 - 1, line_num3 - 1);
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  // lines are moved after line_num3 (0 for before first line), which can't be in range
+  if (line_num3 < 0 || line_num3 > int(file_->getNumLines()) ||
+      (line_num3 >= line_num1 && line_num3 < line_num2)) {
+    error("Invalid destination: " + CStrUtil::toString(line_num3));
+    return;
   }
 
+  // one splice of range and lines between range and destination
+  file_->startGroup();
+
+  util_->moveLines(uint(line_num1 - 1), uint(line_num2 - 1), line_num3 - 1);
+
   file_->endGroup();
+
+  // current line is last moved line
+  int line_num4 = line_num3;
+
+  if (line_num3 < line_num1)
+    line_num4 += line_num2 - line_num1 + 1;
+
+  setPos(CIPoint2D(0, line_num4 - 1));
 }
 
 void
 CTextFileEd::
 doCopy(int line_num1, int line_num2, int line_num3)
 {
-  file_->startGroup();
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
 
-  if      (line_num3 < line_num1) {
-    for (int i = line_num2; i >= line_num1; --i)
-      util_->copyLine(line_num2 - 1, line_num3 - 1);
-  }
-  else if (line_num3 > line_num2) {
-    for (int i = line_num2; i >= line_num1; --i)
-      util_->copyLine(i - 1, line_num3 - 1);
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  // lines are copied after line_num3 (0 for before first line)
+  if (line_num3 < 0 || line_num3 > int(file_->getNumLines())) {
+    error("Invalid destination: " + CStrUtil::toString(line_num3));
+    return;
   }
 
+  // one splice inserting shared lines
+  file_->startGroup();
+
+  util_->copyLines(uint(line_num1 - 1), uint(line_num2 - 1), line_num3 - 1);
+
   file_->endGroup();
+
+  // current line is last copied line
+  setPos(CIPoint2D(0, line_num3 + line_num2 - line_num1));
 }
 
 void
 CTextFileEd::
 doDelete(int line_num1, int line_num2)
 {
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
+
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  // one splice for whole range
   file_->startGroup();
 
-  for (int i = line_num1; i <= line_num2; ++i)
-    deleteLine(line_num1 - 1);
+  util_->deleteLines(uint(line_num1 - 1), uint(line_num2 - 1));
 
   file_->endGroup();
 
@@ -1245,71 +1732,163 @@ void
 CTextFileEd::
 doExecute(int line_num1, int line_num2, const std::string &cmdStr)
 {
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
+
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  // stream lines through command and replace them by its output in one splice
+  CTextFileFilter filter(file_);
+
+  filter.setProgressProc([&](uint numLines, uint totalLines) {
+    return edNotifyFilterProgress(numLines, totalLines);
+  });
+
   file_->startGroup();
 
-  std::string src;
+  bool rc = filter.filter(line_num1 - 1, line_num2 - 1, cmdStr);
 
-  for (int i = line_num1; i <= line_num2; ++i) {
-    if (i > line_num1) src += "\n";
+  file_->endGroup();
 
-    src += file_->getLine(line_num1 - 1);
+  // final progress (done)
+  uint numLines = uint(line_num2 - line_num1 + 1);
 
-    deleteLine(line_num1 - 1);
-  }
+  edNotifyFilterProgress(numLines, numLines);
 
-  CCommand cmd(cmdStr);
+  if (! rc) {
+    error(filter.getError());
+    return;
+  }
 
-  std::string dest;
+  setPos(CIPoint2D(0, line_num1 - 1));
+}
 
-  cmd.addStringSrc (src);
-  cmd.addStringDest(dest);
+void
+CTextFileEd::
+doSort(int line_num1, int line_num2, const std::string &opts, const std::string &pattern)
+{
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
 
-  cmd.start();
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
 
-  cmd.wait();
+  // sort shared lines in process and replace them in one splice
+  CTextFileSort sort(file_);
 
-  std::vector<std::string> lines;
+  sort.setNumeric      (opts.find('n') != std::string::npos);
+  sort.setUnique       (opts.find('u') != std::string::npos);
+  sort.setReverse      (opts.find('r') != std::string::npos);
+  sort.setCaseSensitive(getCaseSensitive() && opts.find('i') == std::string::npos);
+  sort.setPattern      (pattern);
 
-  CStrUtil::addLines(dest, lines);
+  file_->startGroup();
 
-  int numLines = int(lines.size());
+  sort.sort(uint(line_num1 - 1), uint(line_num2 - 1));
 
-  for (int l = 0; l < numLines; ++l)
-    addLine(line_num1 + l - 1, lines[l]);
+  file_->endGroup();
 
   setPos(CIPoint2D(0, line_num1 - 1));
+}
+
+void
+CTextFileEd::
+doUniq(int line_num1, int line_num2, bool adjacent)
+{
+  line_num2 = std::min(line_num2, int(file_->getNumLines()));
+
+  if (line_num1 < 1 || line_num2 < line_num1)
+    return;
+
+  CTextFileUtil::LineNums lines;
+
+  util_->duplicateLines(uint(line_num1 - 1), uint(line_num2 - 1), adjacent, lines);
+
+  if (lines.empty())
+    return;
+
+  // remaining lines compacted in one splice
+  file_->startGroup();
+
+  util_->deleteLines(lines);
 
   file_->endGroup();
+
+  setPos(CIPoint2D(0, line_num1 - 1));
 }
 
 void
 CTextFileEd::
 doPrint(int line_num1, int line_num2, bool numbered, bool eol)
 {
-  for (int i = line_num1; i <= line_num2; ++i) {
-    const std::string &line = file_->getLine(i - 1);
+  for (int i = line_num1; i <= line_num2; ++i)
+    printLine(uint(i - 1), numbered, eol);
 
-    std::string str;
+  flushOutput();
+}
 
-    if (numbered) {
-      str += CStrUtil::toString(i);
-      str += "\t";
-    }
+void
+CTextFileEd::
+printLine(uint line_num, bool numbered, bool eol)
+{
+  // lines are formatted into a reused buffer which is output in large blocks
+  static const uint s_outputBlockSize = 65536;
+
+  if (numbered) {
+    // format line number without a temporary string
+    char buffer[16];
+
+    char *p = buffer + sizeof(buffer);
 
-    str += line;
+    uint i = line_num + 1;
 
-    if (eol)
-      str += "$";
+    do {
+      *--p = char('0' + i % 10);
 
-    output(str);
+      i /= 10;
+    } while (i > 0);
+
+    outputBuffer_.append(p, buffer + sizeof(buffer));
+
+    outputBuffer_ += '\t';
   }
+
+  outputBuffer_ += file_->getLine(line_num);
+
+  if (eol)
+    outputBuffer_ += '$';
+
+  outputBuffer_ += '\n';
+
+  if (outputBuffer_.size() >= s_outputBlockSize)
+    flushOutput();
+}
+
+void
+CTextFileEd::
+flushOutput()
+{
+  if (outputBuffer_.empty())
+    return;
+
+  outputLines(outputBuffer_);
+
+  // keep capacity for next output
+  outputBuffer_.clear();
 }
 
 void
 CTextFileEd::
 output(const std::string &msg)
 {
-  std::cout << msg << std::endl;
+  outputLines(msg + "\n");
+}
+
+void
+CTextFileEd::
+outputLines(const std::string &text)
+{
+  if (! edNotifyOutput(text))
+    std::cout << text << std::flush;
 }
 
 void
@@ -1394,6 +1973,27 @@ edNotifyQuit(bool force)
   notifyMgr_->edNotifyQuit(force);
 }
 
+bool
+CTextFileEd::
+edNotifyFilterProgress(uint numLines, uint totalLines)
+{
+  return notifyMgr_->edNotifyFilterProgress(numLines, totalLines);
+}
+
+bool
+CTextFileEd::
+edNotifyOutput(const std::string &text)
+{
+  return notifyMgr_->edNotifyOutput(text);
+}
+
+bool
+CTextFileEd::
+edNotifyCount(uint numMatches, uint numLines, const std::string &msg)
+{
+  return notifyMgr_->edNotifyCount(numMatches, numLines, msg);
+}
+
 //------
 
 CTextFileEdNotifierMgr::
@@ -1426,6 +2026,54 @@ edNotifyQuit(bool force)
     (*p1)->edNotifyQuit(force);
 }
 
+bool
+CTextFileEdNotifierMgr::
+edNotifyFilterProgress(uint numLines, uint totalLines)
+{
+  bool rc = true;
+
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1) {
+    if (! (*p1)->edNotifyFilterProgress(numLines, totalLines))
+      rc = false;
+  }
+
+  return rc;
+}
+
+bool
+CTextFileEdNotifierMgr::
+edNotifyOutput(const std::string &text)
+{
+  bool handled = false;
+
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1) {
+    if ((*p1)->edNotifyOutput(text))
+      handled = true;
+  }
+
+  return handled;
+}
+
+bool
+CTextFileEdNotifierMgr::
+edNotifyCount(uint numMatches, uint numLines, const std::string &msg)
+{
+  bool handled = false;
+
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1) {
+    if ((*p1)->edNotifyCount(numMatches, numLines, msg))
+      handled = true;
+  }
+
+  return handled;
+}
+
 //------
 
 CTextFileEdNotifier::
@@ -1438,3 +2086,24 @@ CTextFileEdNotifier::
 edNotifyQuit(bool)
 {
 }
+
+bool
+CTextFileEdNotifier::
+edNotifyFilterProgress(uint, uint)
+{
+  return true;
+}
+
+bool
+CTextFileEdNotifier::
+edNotifyOutput(const std::string &)
+{
+  return false;
+}
+
+bool
+CTextFileEdNotifier::
+edNotifyCount(uint, uint, const std::string &)
+{
+  return false;
+}
@@ -0,0 +1,296 @@
+#include <CTextFileEdScript.h>
+#include <CTextFileEd.h>
+#include <CTextFileSubst.h>
+#include <CTextFileUtil.h>
+#include <CFile.h>
+#include <CStrUtil.h>
+#include <CStrParse.h>
+#include <cstring>
+
+namespace {
+
+// read chars up to separator (and skip separator)
+void readDelimited(CStrParse &parse, char sep, std::string &str)
+{
+  while (! parse.eof() && ! parse.isChar(sep)) {
+    char c;
+
+    parse.readChar(&c);
+
+    str += c;
+  }
+
+  if (parse.isChar(sep))
+    parse.skipChar();
+}
+
+}
+
+//------
+
+CTextFileEdScript::
+CTextFileEdScript(bool caseSensitive) :
+ caseSensitive_(caseSensitive)
+{
+}
+
+CTextFileEdScript::
+CTextFileEdScript(const CTextFileEdScript &script) :
+ caseSensitive_(script.caseSensitive_), ex_(script.ex_), error_(script.error_)
+{
+  for (const auto &cmd : script.cmds_)
+    cmds_.push_back(copyCmd(*cmd));
+}
+
+CTextFileEdScript &
+CTextFileEdScript::
+operator=(const CTextFileEdScript &script)
+{
+  if (this == &script)
+    return *this;
+
+  caseSensitive_ = script.caseSensitive_;
+  ex_            = script.ex_;
+  error_         = script.error_;
+
+  cmds_.clear();
+
+  for (const auto &cmd : script.cmds_)
+    cmds_.push_back(copyCmd(*cmd));
+
+  return *this;
+}
+
+bool
+CTextFileEdScript::
+compileFile(const std::string &fileName)
+{
+  CFile file(fileName);
+
+  if (! file.exists() || ! file.isRegular()) {
+    error_ = "Invalid file '" + fileName + "'";
+    return false;
+  }
+
+  std::vector<std::string> lines;
+
+  file.toLines(lines);
+
+  return compile(lines);
+}
+
+bool
+CTextFileEdScript::
+compile(const std::vector<std::string> &lines)
+{
+  cmds_.clear();
+
+  error_ = "";
+
+  // lines after a, c or i up to "." are input mode text
+  bool input = false;
+
+  uint numLines = uint(lines.size());
+
+  for (uint i = 0; i < numLines; ++i) {
+    std::string line = CStrUtil::stripSpaces(lines[i]);
+
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    CTextFileEdCmdP cmd = std::make_shared<CTextFileEdCmd>();
+
+    if (input) {
+      cmd->line = line;
+      cmd->text = true;
+
+      if (line == ".")
+        input = false;
+    }
+    else {
+      std::string msg;
+
+      if (! compileCmd(line, caseSensitive_, ex_, *cmd, msg)) {
+        error_ = "Line " + CStrUtil::toString(i + 1) + ": " + msg;
+
+        cmds_.clear();
+
+        return false;
+      }
+
+      if (! cmd->body.empty() && strchr("aci", cmd->body[0]))
+        input = true;
+    }
+
+    cmds_.push_back(cmd);
+  }
+
+  return true;
+}
+
+bool
+CTextFileEdScript::
+exec(CTextFileEd *ed) const
+{
+  bool rc = true;
+
+  for (const auto &cmd : cmds_) {
+    if (! ed->execCmd(*cmd))
+      rc = false;
+
+    // report dry run count before next command
+    ed->pollDryRun(/*wait*/true);
+
+    if (ed->isQuit())
+      break;
+  }
+
+  return rc;
+}
+
+bool
+CTextFileEdScript::
+compileCmd(const std::string &line, bool caseSensitive, bool ex,
+           CTextFileEdCmd &cmd, std::string &msg)
+{
+  cmd = CTextFileEdCmd();
+
+  cmd.line = line;
+
+  CStrParse parse(line);
+
+  if (! CTextFileEd::parseRange(parse, ex, cmd.addrs, msg))
+    return false;
+
+  // literal patterns are left uncompiled for the literal search
+  for (auto &addr : cmd.addrs) {
+    if ((addr.type == CTextFileEdAddr::Type::FIND_NEXT ||
+         addr.type == CTextFileEdAddr::Type::FIND_PREV) &&
+        ! CTextFileUtil::isLiteralPattern(addr.pattern))
+      addr.regexp = compileRegExp(addr.pattern, caseSensitive);
+  }
+
+  parse.skipSpace();
+
+  cmd.body = parse.getAt();
+
+  //---
+
+  // compile patterns of substitute and global commands (an empty pattern uses the
+  // previous find pattern and a count is rare so those are left to the command parse)
+  CStrParse parse1(cmd.body);
+
+  char c;
+
+  if (! parse1.readChar(&c))
+    return true;
+
+  if      (c == 's') {
+    if (CTextFileEd::isNamedCmd(cmd.body, "sort"))
+      return true;
+
+    char sep;
+
+    if (! parse1.readChar(&sep))
+      return true;
+
+    std::string find, replace;
+
+    readDelimited(parse1, sep, find);
+    readDelimited(parse1, sep, replace);
+
+    bool global = false;
+
+    while (! parse1.eof() && ! parse1.isSpace()) {
+      char c1;
+
+      parse1.readChar(&c1);
+
+      if (c1 != 'g')
+        return true;
+
+      global = true;
+    }
+
+    parse1.skipSpace();
+
+    if (find.empty() || ! parse1.eof())
+      return true;
+
+    cmd.subst = std::make_shared<CTextFileSubst>(find, replace, global, caseSensitive);
+  }
+  else if (c == 'g' || c == 'v') {
+    bool invert = (c == 'v');
+
+    if (c == 'g' && parse1.isChar('!')) {
+      parse1.skipChar();
+
+      invert = true;
+    }
+
+    char sep;
+
+    if (! parse1.readChar(&sep))
+      return true;
+
+    std::string find;
+
+    readDelimited(parse1, sep, find);
+
+    if (find.empty())
+      return true;
+
+    parse1.skipSpace();
+
+    std::string cmdStr = parse1.getAt();
+
+    if (cmdStr.empty())
+      cmdStr = "p";
+
+    CTextFileEdCmdP cmd1 = std::make_shared<CTextFileEdCmd>();
+
+    if (! compileCmd(cmdStr, caseSensitive, ex, *cmd1, msg))
+      return false;
+
+    cmd.regexp = compileRegExp(find, caseSensitive);
+    cmd.invert = invert;
+    cmd.cmd    = cmd1;
+  }
+
+  return true;
+}
+
+CTextFileEdCmdP
+CTextFileEdScript::
+copyCmd(const CTextFileEdCmd &cmd)
+{
+  CTextFileEdCmdP cmd1 = std::make_shared<CTextFileEdCmd>(cmd);
+
+  for (auto &addr : cmd1->addrs) {
+    if (addr.regexp)
+      addr.regexp = std::make_shared<CRegExp>(*addr.regexp);
+  }
+
+  if (cmd.subst)
+    cmd1->subst = std::make_shared<CTextFileSubst>(*cmd.subst);
+
+  if (cmd.regexp)
+    cmd1->regexp = std::make_shared<CRegExp>(*cmd.regexp);
+
+  if (cmd.cmd)
+    cmd1->cmd = copyCmd(*cmd.cmd);
+
+  return cmd1;
+}
+
+CRegExpP
+CTextFileEdScript::
+compileRegExp(const std::string &pattern, bool caseSensitive)
+{
+  // not from the regexp cache as the cached expressions are shared
+  CRegExpP regexp = std::make_shared<CRegExp>(pattern);
+
+  regexp->setCaseSensitive(caseSensitive);
+
+  return regexp;
+}
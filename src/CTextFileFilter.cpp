@@ -0,0 +1,343 @@
+#include <CTextFileFilter.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// interval between progress calls (ms)
+const int s_progressInterval = 100;
+
+void setNonBlocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+void closeFd(int &fd)
+{
+  if (fd >= 0) {
+    close(fd);
+
+    fd = -1;
+  }
+}
+
+// Blocks SIGPIPE in the calling thread while in scope so a write to a command which
+// has stopped reading fails with EPIPE. The process signal handler is not changed, so
+// other threads are not affected, and a SIGPIPE raised while blocked is consumed.
+class BlockSigPipe {
+ public:
+  BlockSigPipe() {
+    sigemptyset(&set_);
+    sigaddset(&set_, SIGPIPE);
+
+    // leave a SIGPIPE already pending for the thread to the caller
+    sigset_t pending;
+
+    sigemptyset(&pending);
+
+    sigpending(&pending);
+
+    wasPending_ = sigismember(&pending, SIGPIPE);
+
+    if (! wasPending_)
+      pthread_sigmask(SIG_BLOCK, &set_, &oldSet_);
+  }
+
+ ~BlockSigPipe() {
+    if (wasPending_)
+      return;
+
+    // consume SIGPIPE raised by failed write
+    if (raised_) {
+      struct timespec ts = { 0, 0 };
+
+      while (sigtimedwait(&set_, nullptr, &ts) < 0 && errno == EINTR)
+        ;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldSet_, nullptr);
+  }
+
+  void setRaised() { raised_ = true; }
+
+ private:
+  sigset_t set_, oldSet_;
+  bool     wasPending_ { false };
+  bool     raised_     { false };
+};
+
+}
+
+//------
+
+CTextFileFilter::
+CTextFileFilter(CTextFile *file) :
+ file_(file)
+{
+}
+
+bool
+CTextFileFilter::
+filter(uint line_num1, uint line_num2, const std::string &cmd)
+{
+  cancelled_ = false;
+  status_    = 0;
+  error_     = "";
+
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num2 >= numLines) {
+    error_ = "Invalid range";
+    return false;
+  }
+
+  uint n = line_num2 - line_num1 + 1;
+
+  // lines are shared (not copied) so the file is unchanged until the command is done
+  CTextLineList lines = file_->getLines(line_num1, n);
+
+  CTextLineList newLines;
+
+  if (! run(cmd, lines, newLines))
+    return false;
+
+  file_->spliceLines(line_num1, n, newLines);
+
+  return true;
+}
+
+bool
+CTextFileFilter::
+run(const std::string &cmd, const CTextLineList &lines, CTextLineList &newLines)
+{
+  partial_ = "";
+
+  // pipe fds are not inherited by other commands run at the same time (close on exec)
+  int inPipe[2], outPipe[2];
+
+  if (pipe2(inPipe, O_CLOEXEC) != 0) {
+    error_ = std::string("Failed to create pipe: ") + strerror(errno);
+    return false;
+  }
+
+  if (pipe2(outPipe, O_CLOEXEC) != 0) {
+    error_ = std::string("Failed to create pipe: ") + strerror(errno);
+
+    close(inPipe[0]); close(inPipe[1]);
+
+    return false;
+  }
+
+  pid_t pid = fork();
+
+  if (pid < 0) {
+    error_ = std::string("Failed to run command: ") + strerror(errno);
+
+    close(inPipe [0]); close(inPipe [1]);
+    close(outPipe[0]); close(outPipe[1]);
+
+    return false;
+  }
+
+  // child runs command with pipes as stdin and stdout (dup2 clears close on exec)
+  if (pid == 0) {
+    dup2(inPipe [0], STDIN_FILENO);
+    dup2(outPipe[1], STDOUT_FILENO);
+
+    close(inPipe [0]); close(inPipe [1]);
+    close(outPipe[0]); close(outPipe[1]);
+
+    execl("/bin/sh", "sh", "-c", cmd.c_str(), static_cast<char *>(nullptr));
+
+    _exit(127);
+  }
+
+  close(inPipe [0]);
+  close(outPipe[1]);
+
+  int inFd  = inPipe [1];
+  int outFd = outPipe[0];
+
+  setNonBlocking(inFd);
+  setNonBlocking(outFd);
+
+  // command may exit before reading all its input so block SIGPIPE (write fails)
+  BlockSigPipe blockSigPipe;
+
+  //---
+
+  uint numLines = uint(lines.size());
+  uint lineNum  = 0;
+
+  std::string inBuffer;
+  uint        inPos = 0;
+
+  std::vector<char> outBuffer(chunkSize_);
+
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::time_point progressTime = Clock::now();
+
+  while (outFd >= 0) {
+    // next chunk of input lines
+    if (inFd >= 0 && inPos >= inBuffer.size()) {
+      inBuffer.clear();
+
+      inPos = 0;
+
+      while (lineNum < numLines && inBuffer.size() < chunkSize_) {
+        inBuffer += lines[lineNum++]->getString();
+        inBuffer += '\n';
+      }
+
+      // all input written
+      if (inBuffer.empty())
+        closeFd(inFd);
+    }
+
+    struct pollfd fds[2];
+
+    fds[0].fd      = outFd;
+    fds[0].events  = POLLIN;
+    fds[0].revents = 0;
+
+    int nfds = 1;
+
+    if (inFd >= 0) {
+      fds[1].fd      = inFd;
+      fds[1].events  = POLLOUT;
+      fds[1].revents = 0;
+
+      ++nfds;
+    }
+
+    int rc = poll(fds, nfds_t(nfds), s_progressInterval);
+
+    if (rc < 0 && errno != EINTR) {
+      error_ = std::string("Failed to wait for command: ") + strerror(errno);
+      break;
+    }
+
+    if (progressProc_) {
+      Clock::time_point t = Clock::now();
+
+      if (std::chrono::duration_cast<std::chrono::milliseconds>(t - progressTime).count() >=
+          s_progressInterval) {
+        progressTime = t;
+
+        if (! progressProc_(lineNum, numLines)) {
+          cancelled_ = true;
+          break;
+        }
+      }
+    }
+
+    if (rc <= 0)
+      continue;
+
+    // write input
+    if (nfds > 1 && fds[1].revents != 0) {
+      ssize_t n = write(inFd, &inBuffer[inPos], inBuffer.size() - inPos);
+
+      if      (n > 0)
+        inPos += uint(n);
+      // command stopped reading (EPIPE)
+      else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+        if (errno == EPIPE)
+          blockSigPipe.setRaised();
+
+        closeFd(inFd);
+      }
+    }
+
+    // read output
+    if (fds[0].revents != 0) {
+      ssize_t n = read(outFd, &outBuffer[0], outBuffer.size());
+
+      if      (n > 0)
+        addOutput(&outBuffer[0], uint(n), newLines);
+      else if (n == 0 || (errno != EAGAIN && errno != EINTR))
+        closeFd(outFd);
+    }
+  }
+
+  bool failed = (outFd >= 0);
+
+  closeFd(inFd);
+  closeFd(outFd);
+
+  if (cancelled_)
+    kill(pid, SIGTERM);
+
+  int status = 0;
+
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    ;
+
+  //---
+
+  if (cancelled_) {
+    error_ = "Cancelled";
+    return false;
+  }
+
+  if (failed)
+    return false;
+
+  if      (WIFEXITED(status))
+    status_ = WEXITSTATUS(status);
+  else if (WIFSIGNALED(status))
+    status_ = 128 + WTERMSIG(status);
+
+  if (status_ != 0) {
+    error_ = "Command failed (status " + std::to_string(status_) + ")";
+    return false;
+  }
+
+  if (! partial_.empty()) {
+    newLines.push_back(file_->createLine(partial_));
+
+    partial_ = "";
+  }
+
+  return true;
+}
+
+void
+CTextFileFilter::
+addOutput(const char *data, uint len, CTextLineList &newLines)
+{
+  const char *p1 = data;
+  const char *p2 = data + len;
+
+  while (p1 < p2) {
+    const char *p = static_cast<const char *>(memchr(p1, '\n', size_t(p2 - p1)));
+
+    if (! p) {
+      partial_.append(p1, p2);
+      break;
+    }
+
+    if (partial_.empty())
+      newLines.push_back(file_->createLine(std::string(p1, p)));
+    else {
+      partial_.append(p1, p);
+
+      newLines.push_back(file_->createLine(partial_));
+
+      partial_ = "";
+    }
+
+    p1 = p + 1;
+  }
+}
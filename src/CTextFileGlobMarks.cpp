@@ -0,0 +1,152 @@
+#include <CTextFileGlobMarks.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+CTextFileGlobMarks::
+CTextFileGlobMarks(CTextFile *file, const LineNums &lines) :
+ file_(file)
+{
+  lines_.assign(lines.begin(), lines.end());
+
+  file_->addNotifier(this);
+}
+
+CTextFileGlobMarks::
+~CTextFileGlobMarks()
+{
+  file_->removeNotifier(this);
+}
+
+bool
+CTextFileGlobMarks::
+nextMark(uint *line_num)
+{
+  if (pos_ >= lines_.size())
+    return false;
+
+  *line_num = uint(lines_[pos_] + offset_);
+
+  ++pos_;
+
+  return true;
+}
+
+void
+CTextFileGlobMarks::
+fileOpened(const std::string &)
+{
+  pos_ = uint(lines_.size());
+}
+
+void
+CTextFileGlobMarks::
+lineAdded(const std::string &, uint line_num)
+{
+  shiftMarks(line_num, 0, 1, nullptr, nullptr);
+}
+
+void
+CTextFileGlobMarks::
+lineDeleted(const std::string &, uint line_num)
+{
+  shiftMarks(line_num, 1, 0, nullptr, nullptr);
+}
+
+void
+CTextFileGlobMarks::
+linesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  shiftMarks(line_num, uint(oldLines.size()), uint(newLines.size()), &oldLines, &newLines);
+}
+
+// replace n lines at line_num by count lines. A mark on a replaced line moves with
+// its line if it is in the new lines, or stays if a new line replaces it
+void
+CTextFileGlobMarks::
+shiftMarks(uint line_num, uint n, uint count,
+           const CTextLineList *oldLines, const CTextLineList *newLines)
+{
+  uint numMarks = uint(lines_.size());
+
+  if (pos_ >= numMarks || (n == 0 && count == 0))
+    return;
+
+  int line_num1 = int(line_num);
+  int line_num2 = int(line_num + n); // end of replaced lines
+
+  int d = int(count) - int(n);
+
+  // edit before all remaining marks
+  if (lines_[pos_] + offset_ >= line_num2) {
+    offset_ += d;
+    return;
+  }
+
+  // edit after all remaining marks (e.g. :g/pat/t$)
+  if (line_num1 > lines_.back() + offset_)
+    return;
+
+  // update remaining marks (which are kept in line order)
+  typedef std::unordered_map<const CTextLine *,uint> LinePos;
+  typedef std::unordered_set<const CTextLine *>      LineSet;
+
+  LinePos newPos;
+  LineSet oldSet;
+  bool    mapped = false;
+
+  auto mapLines = [&]() {
+    for (uint i = 0; i < count; ++i)
+      newPos.emplace((*newLines)[i].get(), i);
+
+    for (uint i = 0; i < n; ++i)
+      oldSet.insert((*oldLines)[i].get());
+
+    mapped = true;
+  };
+
+  Lines lines;
+
+  lines.reserve(numMarks - pos_);
+
+  bool sorted = true;
+
+  for (uint i = pos_; i < numMarks; ++i) {
+    int line = lines_[i] + offset_;
+
+    if      (line >= line_num2)
+      line += d;
+    else if (line >= line_num1) {
+      uint j = uint(line - line_num1);
+
+      if (oldLines) {
+        if (! mapped)
+          mapLines();
+
+        auto p = newPos.find((*oldLines)[j].get());
+
+        if      (p != newPos.end())
+          line = line_num1 + int((*p).second);
+        else if (j >= count || oldSet.find((*newLines)[j].get()) != oldSet.end())
+          continue;
+      }
+      else if (j >= count)
+        continue;
+    }
+
+    if (! lines.empty() && line <= lines.back())
+      sorted = false;
+
+    lines.push_back(line);
+  }
+
+  if (! sorted) {
+    std::sort(lines.begin(), lines.end());
+
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+  }
+
+  lines_  = std::move(lines);
+  pos_    = 0;
+  offset_ = 0;
+}
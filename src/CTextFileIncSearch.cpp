@@ -0,0 +1,496 @@
+#include <CTextFileIncSearch.h>
+#include <CTextFileStrSearch.h>
+#include <algorithm>
+
+namespace {
+
+// lines checked for a match when a pattern is set (rest is left to the background scan)
+const uint s_maxSyncLines = 256;
+
+}
+
+//------
+
+CTextFileIncSearch::
+CTextFileIncSearch(CTextFile *file) :
+ file_(file)
+{
+  file_->addNotifier(this);
+}
+
+CTextFileIncSearch::
+~CTextFileIncSearch()
+{
+  end();
+
+  file_->removeNotifier(this);
+}
+
+void
+CTextFileIncSearch::
+start(uint line_num, uint char_num, bool forward, bool caseSensitive)
+{
+  end();
+
+  active_        = true;
+  forward_       = forward;
+  caseSensitive_ = caseSensitive;
+  startLine_     = line_num;
+  startChar_     = char_num;
+}
+
+void
+CTextFileIncSearch::
+end()
+{
+  invalidate();
+
+  active_  = false;
+  pattern_ = "";
+  pending_ = false;
+}
+
+bool
+CTextFileIncSearch::
+setPattern(const std::string &pattern, uint *line_num, uint *char_num)
+{
+  if (! active_)
+    return false;
+
+  pattern_ = pattern;
+  pending_ = false;
+
+  addScanResults();
+
+  if (pattern_.empty()) {
+    cancelScan();
+    return false;
+  }
+
+  CandidatesP parent = findParent(pattern_);
+
+  // set for pattern known so nearest match is first candidate line
+  if (parent && parent->pattern == pattern_)
+    return (findMatch(parent, 0, line_num, char_num) > 0);
+
+  startScan(parent);
+
+  // check lines nearest start, leave rest to scan
+  int rc = findMatch(parent, s_maxSyncLines, line_num, char_num);
+
+  pending_ = (rc < 0);
+
+  return (rc > 0);
+}
+
+bool
+CTextFileIncSearch::
+poll(uint *line_num, uint *char_num)
+{
+  if (! active_ || ! pending_)
+    return false;
+
+  addScanResults();
+
+  CandidatesP parent = findParent(pattern_);
+
+  if (! parent || parent->pattern != pattern_) {
+    // restart scan if stopped (e.g. by an edit)
+    if (! scanning_)
+      startScan(parent);
+
+    return false;
+  }
+
+  pending_ = false;
+
+  return (findMatch(parent, 0, line_num, char_num) > 0);
+}
+
+CTextFileIncSearch::CandidatesP
+CTextFileIncSearch::
+findParent(const std::string &pattern) const
+{
+  CandidatesP parent;
+
+  for (const auto &pc : candidates_) {
+    const std::string &pattern1 = pc.first;
+
+    if (pattern.compare(0, pattern1.size(), pattern1) != 0)
+      continue;
+
+    if (! parent || pattern1.size() > parent->pattern.size())
+      parent = pc.second;
+  }
+
+  return parent;
+}
+
+int
+CTextFileIncSearch::
+findMatch(const CandidatesP &parent, uint maxLines, uint *line_num, uint *char_num) const
+{
+  uint numLines = file_->getNumLines();
+
+  if (startLine_ >= numLines)
+    return 0;
+
+  uint fline_num = startLine_, fchar_num = 0;
+
+  uint n = 0;
+
+  auto setMatch = [&]() {
+    *line_num = fline_num;
+    *char_num = fchar_num;
+    return 1;
+  };
+
+  auto checkLine = [&](uint i) {
+    if (maxLines > 0 && ++n > maxLines)
+      return -1;
+
+    fline_num = i;
+
+    return (findLineMatch(i, 0, -1, &fchar_num) ? setMatch() : 0);
+  };
+
+  // check lines after start line in search order (wrapping), only parent lines if set
+  auto checkLines = [&]() {
+    int rc = 0;
+
+    if (parent) {
+      const LineNums &lines = parent->lines;
+
+      if (forward_) {
+        auto p = std::upper_bound(lines.begin(), lines.end(), startLine_);
+
+        for (auto p1 = p; p1 != lines.end(); ++p1)
+          if ((rc = checkLine(*p1)) != 0) return rc;
+
+        for (auto p1 = lines.begin(); p1 != lines.end() && *p1 < startLine_; ++p1)
+          if ((rc = checkLine(*p1)) != 0) return rc;
+      }
+      else {
+        auto p = std::lower_bound(lines.begin(), lines.end(), startLine_);
+
+        for (auto p1 = LineNums::const_reverse_iterator(p); p1 != lines.rend(); ++p1)
+          if ((rc = checkLine(*p1)) != 0) return rc;
+
+        for (auto p1 = lines.rbegin(); p1 != lines.rend() && *p1 > startLine_; ++p1)
+          if ((rc = checkLine(*p1)) != 0) return rc;
+      }
+    }
+    else {
+      if (forward_) {
+        for (uint i = startLine_ + 1; i < numLines; ++i)
+          if ((rc = checkLine(i)) != 0) return rc;
+
+        for (uint i = 0; i < startLine_; ++i)
+          if ((rc = checkLine(i)) != 0) return rc;
+      }
+      else {
+        for (uint i = startLine_; i > 0; --i)
+          if ((rc = checkLine(i - 1)) != 0) return rc;
+
+        for (uint i = numLines - 1; i > startLine_; --i)
+          if ((rc = checkLine(i)) != 0) return rc;
+      }
+    }
+
+    return rc;
+  };
+
+  int rc;
+
+  if (forward_) {
+    // rest of start line, lines after, lines before, start of start line
+    if (findLineMatch(startLine_, startChar_ + 1, -1, &fchar_num))
+      return setMatch();
+
+    if ((rc = checkLines()) != 0)
+      return rc;
+
+    fline_num = startLine_;
+
+    if (findLineMatch(startLine_, 0, startChar_, &fchar_num))
+      return setMatch();
+  }
+  else {
+    // start of start line, lines before, lines after, rest of start line
+    if (startChar_ > 0 && findLineMatch(startLine_, 0, startChar_ - 1, &fchar_num))
+      return setMatch();
+
+    if ((rc = checkLines()) != 0)
+      return rc;
+
+    fline_num = startLine_;
+
+    if (findLineMatch(startLine_, startChar_, -1, &fchar_num))
+      return setMatch();
+  }
+
+  return 0;
+}
+
+// find first (forward) or last (backward) match starting in [char_num1, char_num2]
+bool
+CTextFileIncSearch::
+findLineMatch(uint line_num, int char_num1, int char_num2, uint *char_num) const
+{
+  const std::string &line = file_->getLine(line_num);
+
+  int len  = int(line.size());
+  int plen = int(pattern_.size());
+
+  if (char_num2 < 0 || char_num2 >= len)
+    char_num2 = len - 1;
+
+  if (char_num1 > char_num2)
+    return false;
+
+  int pos;
+
+  if (forward_) {
+    pos = CTextFileStrSearch::findNext(&line[char_num1], uint(len - char_num1),
+                                       pattern_.c_str(), uint(plen), caseSensitive_);
+
+    if (pos >= 0)
+      pos += char_num1;
+
+    if (pos > char_num2)
+      pos = -1;
+  }
+  else {
+    int end = std::min(char_num2 + plen, len);
+
+    pos = CTextFileStrSearch::findPrev(&line[char_num1], uint(end - char_num1),
+                                       pattern_.c_str(), uint(plen), caseSensitive_);
+
+    if (pos >= 0)
+      pos += char_num1;
+  }
+
+  if (pos < 0)
+    return false;
+
+  *char_num = uint(pos);
+
+  return true;
+}
+
+void
+CTextFileIncSearch::
+startScan(const CandidatesP &parent)
+{
+  std::string base = (parent ? parent->pattern : "");
+
+  {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  scanPattern_ = pattern_;
+
+  // running scan goes on to latest pattern if it extends the set the scan started from
+  if (scanning_ && pattern_.compare(0, scanBase_.size(), scanBase_) == 0)
+    return;
+  }
+
+  cancelScan();
+
+  // lines are copied on write so snapshot lines can be read in the scan thread
+  if (lines_.empty())
+    lines_ = file_->getSnapshot().lines;
+
+  uint gen = ++generation_;
+
+  scanBase_ = base;
+  scanning_ = true;
+
+  scanThread_ = std::thread([this, gen, parent]() {
+    // sets built by this scan (null for all lines)
+    CandidatesList sets;
+
+    sets.push_back(parent);
+
+    while (true) {
+      CandidatesP set;
+      std::string pattern;
+
+      {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // longest set which is a prefix of latest pattern, stop if none or pattern done
+      bool found = false;
+
+      for (auto p = sets.rbegin(); p != sets.rend(); ++p) {
+        if (! *p || scanPattern_.compare(0, (*p)->pattern.size(), (*p)->pattern) == 0) {
+          set   = *p;
+          found = true;
+          break;
+        }
+      }
+
+      if (generation_ != gen || ! found || (set && set->pattern == scanPattern_)) {
+        scanning_ = false;
+        return;
+      }
+
+      pattern = scanPattern_;
+      }
+
+      CandidatesP result = scanLines(set, pattern, gen);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if (! result || generation_ != gen) {
+        scanning_ = false;
+        return;
+      }
+
+      scanResults_.push_back(result);
+
+      sets.push_back(result);
+    }
+  });
+}
+
+CTextFileIncSearch::CandidatesP
+CTextFileIncSearch::
+scanLines(const CandidatesP &parent, const std::string &pattern, uint gen) const
+{
+  CandidatesP result = std::make_shared<Candidates>();
+
+  result->pattern = pattern;
+
+  uint plen = uint(pattern.size());
+
+  auto checkLine = [&](uint i) {
+    const std::string &line = lines_[i]->getString();
+
+    if (CTextFileStrSearch::findNext(line.data(), uint(line.size()),
+                                     pattern.c_str(), plen, caseSensitive_) >= 0)
+      result->lines.push_back(i);
+  };
+
+  // stop if stale (file changed or session ended)
+  if (parent) {
+    uint n = 0;
+
+    for (uint i : parent->lines) {
+      if ((++n & 0xfff) == 0 && generation_ != gen)
+        return CandidatesP();
+
+      checkLine(i);
+    }
+  }
+  else {
+    uint numLines = uint(lines_.size());
+
+    for (uint i = 0; i < numLines; ++i) {
+      if ((i & 0xfff) == 0 && generation_ != gen)
+        return CandidatesP();
+
+      checkLine(i);
+    }
+  }
+
+  return result;
+}
+
+void
+CTextFileIncSearch::
+cancelScan()
+{
+  ++generation_;
+
+  if (scanThread_.joinable())
+    scanThread_.join();
+
+  scanning_ = false;
+}
+
+// move finished sets to candidates and drop sets for patterns which are not
+// prefixes of the current pattern
+void
+CTextFileIncSearch::
+addScanResults()
+{
+  {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (const auto &result : scanResults_)
+    candidates_[result->pattern] = result;
+
+  scanResults_.clear();
+  }
+
+  for (auto p = candidates_.begin(); p != candidates_.end(); ) {
+    if (pattern_.compare(0, (*p).first.size(), (*p).first) != 0)
+      p = candidates_.erase(p);
+    else
+      ++p;
+  }
+}
+
+void
+CTextFileIncSearch::
+invalidate()
+{
+  cancelScan();
+
+  candidates_.clear();
+
+  lines_.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  scanResults_.clear();
+}
+
+void
+CTextFileIncSearch::
+lineAdded(const std::string &, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+lineDeleted(const std::string &, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+lineReplaced(const std::string &, const std::string &, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+charAdded(char, uint, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+charDeleted(char, uint, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+charReplaced(char, char, uint, uint)
+{
+  if (active_) invalidate();
+}
+
+void
+CTextFileIncSearch::
+linesSpliced(uint, const CTextLineList &, const CTextLineList &)
+{
+  if (active_) invalidate();
+}
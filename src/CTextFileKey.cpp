@@ -3,6 +3,8 @@
 #include <CTextFileUndo.h>
 #include <CTextFileSel.h>
 #include <CTextFileUtil.h>
+#include <CTextFileIncSearch.h>
+#include <CTextFileRegExpCache.h>
 
 CTextFileKey::
 CTextFileKey(CTextFile *file) :
@@ -25,6 +27,7 @@ CTextFileKey::
   delete undo_;
   delete sel_;
   delete util_;
+  delete incSearch_;
   delete notifyMgr_;
 }
 
@@ -107,6 +110,20 @@ notifyNumber(bool number)
   notifyMgr_->notifyNumber(number);
 }
 
+void
+CTextFileKey::
+notifyHlSearch(bool hlsearch)
+{
+  notifyMgr_->notifyHlSearch(hlsearch);
+}
+
+void
+CTextFileKey::
+notifyFindPattern(const std::string &pattern)
+{
+  notifyMgr_->notifyFindPattern(pattern);
+}
+
 void
 CTextFileKey::
 notifyQuit()
@@ -114,6 +131,13 @@ notifyQuit()
   notifyMgr_->notifyQuit();
 }
 
+bool
+CTextFileKey::
+notifyProgress(const std::string &msg, uint value, uint maxValue)
+{
+  return notifyMgr_->notifyProgress(msg, value, maxValue);
+}
+
 void
 CTextFileKey::
 extendSelectLeft(int n)
@@ -231,13 +255,28 @@ findNext(const std::string &pattern)
 {
   uint fline_num, fchar_num;
 
-  if (! util_->findNext(pattern, getRow(), getCol() + 1, file_->getNumLines() - 1, -1,
-                        &fline_num, &fchar_num))
+  bool found;
+
+  if (findRegExp_ && ! CTextFileUtil::isLiteralPattern(pattern)) {
+    CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(pattern, caseSensitive_);
+
+    found = util_->findNext(*regexp, getRow(), getCol() + 1, file_->getNumLines() - 1, -1,
+                            &fline_num, &fchar_num, nullptr);
+  }
+  else
+    found = util_->findNext(pattern, getRow(), getCol() + 1, file_->getNumLines() - 1, -1,
+                            &fline_num, &fchar_num, caseSensitive_);
+
+  if (! found)
     return false;
 
   file_->moveTo(fchar_num, fline_num);
 
-  findPattern_ = pattern;
+  if (pattern != findPattern_) {
+    findPattern_ = pattern;
+
+    notifyFindPattern(findPattern_);
+  }
 
   return true;
 }
@@ -255,16 +294,130 @@ findPrev(const std::string &pattern)
 {
   uint fline_num, fchar_num;
 
-  if (! util_->findPrev(pattern, getRow(), getCol() - 1, 0, 0, &fline_num, &fchar_num))
+  bool found;
+
+  if (findRegExp_ && ! CTextFileUtil::isLiteralPattern(pattern)) {
+    CRegExpP regexp = CTextFileRegExpCacheInst->getRegExp(pattern, caseSensitive_);
+
+    found = util_->findPrev(*regexp, getRow(), getCol() - 1, 0, 0,
+                            &fline_num, &fchar_num, nullptr);
+  }
+  else
+    found = util_->findPrev(pattern, getRow(), getCol() - 1, 0, 0,
+                            &fline_num, &fchar_num, caseSensitive_);
+
+  if (! found)
     return false;
 
   file_->moveTo(fchar_num, fline_num);
 
-  findPattern_ = pattern;
+  if (pattern != findPattern_) {
+    findPattern_ = pattern;
+
+    notifyFindPattern(findPattern_);
+  }
+
+  return true;
+}
+
+void
+CTextFileKey::
+startIncSearch(bool forward)
+{
+  if (! incSearch_)
+    incSearch_ = new CTextFileIncSearch(file_);
+
+  incSearch_->start(getRow(), getCol(), forward, caseSensitive_);
+
+  incMatch_ = false;
+}
+
+bool
+CTextFileKey::
+updateIncSearch(const std::string &pattern)
+{
+  if (! isIncSearch())
+    return false;
+
+  uint fline_num, fchar_num;
+
+  // incremental search is literal so a regexp pattern is only found on accept (by the
+  // search it replaces, from the start position)
+  if (findRegExp_ && ! CTextFileUtil::isLiteralPattern(pattern))
+    incMatch_ = incSearch_->setPattern("", &fline_num, &fchar_num);
+  else
+    incMatch_ = incSearch_->setPattern(pattern, &fline_num, &fchar_num);
+
+  // move to match or back to start (until pending match is found)
+  if (incMatch_)
+    file_->moveTo(fchar_num, fline_num);
+  else
+    file_->moveTo(incSearch_->getStartChar(), incSearch_->getStartLine());
+
+  return incMatch_;
+}
+
+bool
+CTextFileKey::
+endIncSearch(bool accept)
+{
+  if (! isIncSearch())
+    return false;
+
+  std::string pattern = incSearch_->getPattern();
+
+  uint line_num = incSearch_->getStartLine();
+  uint char_num = incSearch_->getStartChar();
+
+  incSearch_->end();
+
+  // keep match position or restore start
+  if (! accept || ! incMatch_) {
+    file_->moveTo(char_num, line_num);
+
+    return false;
+  }
+
+  if (pattern != findPattern_) {
+    findPattern_ = pattern;
+
+    notifyFindPattern(findPattern_);
+  }
 
   return true;
 }
 
+bool
+CTextFileKey::
+isIncSearch() const
+{
+  return (incSearch_ && incSearch_->isActive());
+}
+
+bool
+CTextFileKey::
+isIncSearchPending() const
+{
+  return (isIncSearch() && incSearch_->isPending());
+}
+
+bool
+CTextFileKey::
+pollIncSearch()
+{
+  if (! isIncSearchPending())
+    return false;
+
+  uint fline_num, fchar_num;
+
+  incMatch_ = incSearch_->poll(&fline_num, &fchar_num);
+
+  if (incMatch_)
+    file_->moveTo(fchar_num, fline_num);
+
+  return incMatch_;
+}
+
 CIPoint2D
 CTextFileKey::
 getPos() const
@@ -409,6 +562,26 @@ notifyNumber(bool number)
     (*p1)->notifyNumber(number);
 }
 
+void
+CTextFileKeyNotifierMgr::
+notifyHlSearch(bool hlsearch)
+{
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1)
+    (*p1)->notifyHlSearch(hlsearch);
+}
+
+void
+CTextFileKeyNotifierMgr::
+notifyFindPattern(const std::string &pattern)
+{
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1)
+    (*p1)->notifyFindPattern(pattern);
+}
+
 void
 CTextFileKeyNotifierMgr::
 notifyQuit()
@@ -419,6 +592,22 @@ notifyQuit()
     (*p1)->notifyQuit();
 }
 
+bool
+CTextFileKeyNotifierMgr::
+notifyProgress(const std::string &msg, uint value, uint maxValue)
+{
+  bool rc = true;
+
+  NotifierList::const_iterator p1, p2;
+
+  for (p1 = notifierList_.begin(), p2 = notifierList_.end(); p1 != p2; ++p1) {
+    if (! (*p1)->notifyProgress(msg, value, maxValue))
+      rc = false;
+  }
+
+  return rc;
+}
+
 //------
 
 CTextFileKeyNotifier::
@@ -474,8 +663,27 @@ notifyNumber(bool)
 {
 }
 
+void
+CTextFileKeyNotifier::
+notifyHlSearch(bool)
+{
+}
+
+void
+CTextFileKeyNotifier::
+notifyFindPattern(const std::string &)
+{
+}
+
 void
 CTextFileKeyNotifier::
 notifyQuit()
 {
 }
+
+bool
+CTextFileKeyNotifier::
+notifyProgress(const std::string &, uint, uint)
+{
+  return true;
+}
@@ -0,0 +1,86 @@
+#include <CTextFileLineRegExp.h>
+
+CTextFileLineRegExp::
+CTextFileLineRegExp(const std::string &pattern, bool caseSensitive) :
+ pattern_(pattern), caseSensitive_(caseSensitive)
+{
+  compile();
+}
+
+CTextFileLineRegExp::
+CTextFileLineRegExp(const CTextFileLineRegExp &regexp) :
+ pattern_(regexp.pattern_), caseSensitive_(regexp.caseSensitive_)
+{
+  compile();
+}
+
+CTextFileLineRegExp::
+~CTextFileLineRegExp()
+{
+  if (valid_)
+    regfree(&regex_);
+}
+
+void
+CTextFileLineRegExp::
+compile()
+{
+  int flags = (caseSensitive_ ? 0 : REG_ICASE);
+
+  valid_ = (regcomp(&regex_, pattern_.c_str(), flags) == 0);
+
+  if (valid_)
+    matches_.resize(regex_.re_nsub + 1);
+}
+
+bool
+CTextFileLineRegExp::
+find(const std::string &line, uint pos) const
+{
+  matched_ = false;
+
+  if (! valid_ || pos > line.size())
+    return false;
+
+  // match [pos, end) of the whole line (match positions are relative to line start)
+  matches_[0].rm_so = regoff_t(pos);
+  matches_[0].rm_eo = regoff_t(line.size());
+
+  matched_ = (regexec(&regex_, line.c_str(), matches_.size(), &matches_[0],
+                      REG_STARTEND) == 0);
+
+  return matched_;
+}
+
+bool
+CTextFileLineRegExp::
+getMatchRange(int *spos, int *epos) const
+{
+  return getSubMatchRange(-1, spos, epos);
+}
+
+int
+CTextFileLineRegExp::
+getNumSubMatches() const
+{
+  return (valid_ ? int(regex_.re_nsub) : 0);
+}
+
+bool
+CTextFileLineRegExp::
+getSubMatchRange(int i, int *spos, int *epos) const
+{
+  if (! matched_ || i < -1 || i >= getNumSubMatches())
+    return false;
+
+  const regmatch_t &match = matches_[uint(i + 1)];
+
+  // sub match not used by match
+  if (match.rm_so < 0)
+    return false;
+
+  *spos = int(match.rm_so);
+  *epos = int(match.rm_eo) - 1;
+
+  return true;
+}
@@ -1,5 +1,41 @@
 #include <CTextFileMarks.h>
 #include <CTextFile.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+CTextFileMarks::
+CTextFileMarks(CTextFile *file) :
+ file_(file)
+{
+  offsets_.resize(1);
+
+  file_->addNotifier(this);
+}
+
+CTextFileMarks::
+~CTextFileMarks()
+{
+  file_->removeNotifier(this);
+}
+
+CTextFileMarks::MarkList
+CTextFileMarks::
+getMarks() const
+{
+  MarkList marks;
+
+  MarkInd::const_iterator p1 = markInd_.begin();
+  MarkInd::const_iterator p2 = markInd_.end  ();
+
+  for ( ; p1 != p2; ++p1) {
+    uint i = (*p1).second;
+
+    marks[(*p1).first] = CIPoint2D(anchors_[i].char_num, anchorLine(i));
+  }
+
+  return marks;
+}
 
 void
 CTextFileMarks::
@@ -23,25 +59,49 @@ void
 CTextFileMarks::
 setMarkPos(const std::string &mark, uint line_num, uint char_num)
 {
-  marks_[mark] = CIPoint2D(char_num, line_num);
+  MarkInd::iterator p = markInd_.find(mark);
+
+  if (p != markInd_.end()) {
+    uint i = (*p).second;
+
+    invalidateAnchor(i, anchorLine(i));
+  }
+
+  // insert after marks on same line (offsets are zero after rebuild)
+  rebuild();
+
+  Anchor anchor;
+
+  anchor.name     = mark;
+  anchor.line     = int(line_num);
+  anchor.char_num = int(char_num);
+
+  Anchors::iterator pa = std::upper_bound(anchors_.begin(), anchors_.end(), anchor,
+    [](const Anchor &a1, const Anchor &a2) { return a1.line < a2.line; });
+
+  uint ind = uint(pa - anchors_.begin());
+
+  anchors_.insert(pa, anchor);
+
+  offsets_.push_back(0);
+
+  for (uint i = ind; i < anchors_.size(); ++i)
+    markInd_[anchors_[i].name] = i;
 }
 
 bool
 CTextFileMarks::
 getMarkPos(const std::string &mark, uint *line_num, uint *char_num) const
 {
-  MarkList::const_iterator p = marks_.find(mark);
+  MarkInd::const_iterator p = markInd_.find(mark);
 
-  if (p == marks_.end())
+  if (p == markInd_.end())
     return false;
 
-  CIPoint2D pos = (*p).second;
+  uint i = (*p).second;
 
-  if (pos.x < 0 && pos.y < 0)
-    return false;
-
-  *line_num = pos.y;
-  *char_num = pos.x;
+  *line_num = uint(anchorLine(i));
+  *char_num = uint(anchors_[i].char_num);
 
   return true;
 }
@@ -50,19 +110,26 @@ void
 CTextFileMarks::
 unsetMarkPos(const std::string &mark)
 {
-  marks_[mark] = CIPoint2D(-1, -1);
+  MarkInd::iterator p = markInd_.find(mark);
+
+  if (p == markInd_.end())
+    return;
+
+  uint i = (*p).second;
+
+  invalidateAnchor(i, anchorLine(i));
 }
 
 void
 CTextFileMarks::
 clearLineMarks(uint line_num)
 {
-  MarkList::iterator p1 = marks_.begin();
-  MarkList::iterator p2 = marks_.end  ();
+  uint i1 = lowerAnchor(int(line_num));
+  uint i2 = lowerAnchor(int(line_num) + 1);
 
-  for ( ; p1 != p2; ++p1) {
-    if ((*p1).second.y == int(line_num))
-      (*p1).second = CIPoint2D(-1, -1);
+  for (uint i = i1; i < i2; ++i) {
+    if (anchors_[i].valid)
+      invalidateAnchor(i, int(line_num));
   }
 }
 
@@ -71,3 +138,224 @@ CTextFileMarks::
 displayMarks()
 {
 }
+
+void
+CTextFileMarks::
+fileOpened(const std::string &)
+{
+  anchors_.clear();
+  markInd_.clear();
+
+  offsets_.assign(1, 0);
+
+  numInvalid_ = 0;
+}
+
+void
+CTextFileMarks::
+lineAdded(const std::string &, uint line_num)
+{
+  shiftMarks(line_num, 0, 1, nullptr, nullptr);
+}
+
+void
+CTextFileMarks::
+lineDeleted(const std::string &, uint line_num)
+{
+  shiftMarks(line_num, 1, 0, nullptr, nullptr);
+}
+
+void
+CTextFileMarks::
+linesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  shiftMarks(line_num, uint(oldLines.size()), uint(newLines.size()), &oldLines, &newLines);
+}
+
+// line of anchor i (stored line plus sum of offsets of anchors up to i)
+int
+CTextFileMarks::
+anchorLine(uint i) const
+{
+  int line = anchors_[i].line;
+
+  for (uint j = i + 1; j > 0; j -= (j & -j))
+    line += offsets_[j];
+
+  return line;
+}
+
+uint
+CTextFileMarks::
+lowerAnchor(int line_num) const
+{
+  uint i1 = 0;
+  uint i2 = uint(anchors_.size());
+
+  while (i1 < i2) {
+    uint i = (i1 + i2)/2;
+
+    if (anchorLine(i) < line_num)
+      i1 = i + 1;
+    else
+      i2 = i;
+  }
+
+  return i1;
+}
+
+// move anchors i and after by d lines
+void
+CTextFileMarks::
+addOffset(uint i, int d)
+{
+  uint n = uint(anchors_.size());
+
+  for (uint j = i + 1; j <= n; j += (j & -j))
+    offsets_[j] += d;
+}
+
+// remove mark of anchor i, anchor stays (at line_num to keep line order) until rebuild
+void
+CTextFileMarks::
+invalidateAnchor(uint i, int line_num)
+{
+  Anchor &anchor = anchors_[i];
+
+  anchor.line += line_num - anchorLine(i);
+  anchor.valid = false;
+
+  MarkInd::iterator p = markInd_.find(anchor.name);
+
+  if (p != markInd_.end() && (*p).second == i)
+    markInd_.erase(p);
+
+  ++numInvalid_;
+}
+
+// replace n lines at line_num by count lines. A mark on a replaced line moves with
+// its line if it is in the new lines, stays if a new line replaces it, and is removed
+// if its line is deleted
+void
+CTextFileMarks::
+shiftMarks(uint line_num, uint n, uint count,
+           const CTextLineList *oldLines, const CTextLineList *newLines)
+{
+  if (anchors_.empty() || (n == 0 && count == 0))
+    return;
+
+  int line_num1 = int(line_num);
+  int line_num2 = int(line_num + n); // end of replaced lines
+
+  int d = int(count) - int(n);
+
+  uint i1 = lowerAnchor(line_num1);
+  uint i2 = lowerAnchor(line_num2);
+
+  //---
+
+  // update marks on replaced lines
+  typedef std::unordered_map<const CTextLine *,uint> LinePos;
+  typedef std::unordered_set<const CTextLine *>      LineSet;
+
+  LinePos newPos;
+  LineSet oldSet;
+  bool    mapped = false;
+
+  auto mapLines = [&]() {
+    for (uint i = 0; i < count; ++i)
+      newPos.emplace((*newLines)[i].get(), i);
+
+    for (uint i = 0; i < n; ++i)
+      oldSet.insert((*oldLines)[i].get());
+
+    mapped = true;
+  };
+
+  bool moved    = false;
+  int  lastLine = line_num1; // removed marks stay after previous mark in range
+
+  for (uint i = i1; i < i2; ++i) {
+    int line = anchorLine(i);
+
+    if (! anchors_[i].valid) {
+      anchors_[i].line += lastLine - line;
+      continue;
+    }
+
+    uint j = uint(line - line_num1);
+
+    if (oldLines) {
+      if (! mapped)
+        mapLines();
+
+      auto p = newPos.find((*oldLines)[j].get());
+
+      if      (p != newPos.end()) {
+        int line1 = line_num1 + int((*p).second);
+
+        if (line1 != line) {
+          anchors_[i].line += line1 - line;
+
+          moved = true;
+        }
+
+        continue;
+      }
+      else if (j >= count || oldSet.find((*newLines)[j].get()) != oldSet.end()) {
+        invalidateAnchor(i, lastLine);
+        continue;
+      }
+    }
+    else if (j >= count) {
+      invalidateAnchor(i, lastLine);
+      continue;
+    }
+
+    lastLine = line;
+  }
+
+  //---
+
+  // shift marks after replaced lines
+  if (d != 0 && i2 < anchors_.size())
+    addOffset(i2, d);
+
+  // moved marks may be out of order
+  if (moved || 2*numInvalid_ > anchors_.size())
+    rebuild();
+}
+
+void
+CTextFileMarks::
+rebuild()
+{
+  uint n = uint(anchors_.size());
+
+  Anchors anchors;
+
+  anchors.reserve(n - numInvalid_);
+
+  for (uint i = 0; i < n; ++i) {
+    if (! anchors_[i].valid)
+      continue;
+
+    anchors.push_back(anchors_[i]);
+
+    anchors.back().line = anchorLine(i);
+  }
+
+  std::stable_sort(anchors.begin(), anchors.end(), [](const Anchor &a1, const Anchor &a2) {
+    return a1.line < a2.line; });
+
+  anchors_.swap(anchors);
+
+  offsets_.assign(anchors_.size() + 1, 0);
+
+  markInd_.clear();
+
+  for (uint i = 0; i < anchors_.size(); ++i)
+    markInd_[anchors_[i].name] = i;
+
+  numInvalid_ = 0;
+}
@@ -0,0 +1,511 @@
+#include <CTextFileMatchSet.h>
+#include <CTextFileStrSearch.h>
+#include <CTextFileLineRegExp.h>
+
+namespace {
+
+// edits larger than this rematch the file in the background
+const uint s_maxEditLines = 65536;
+
+// edits logged while matching in the background before the result is dropped
+const uint s_maxBuildEdits = 4096;
+
+}
+
+//------
+
+// matches literal or regexp pattern against a line (one per thread)
+class CTextFileMatchSet::Matcher {
+ public:
+  Matcher(const std::string &pattern, bool regexp, bool caseSensitive) :
+   pattern_(pattern), caseSensitive_(caseSensitive) {
+    if (regexp)
+      regexp_ = std::make_unique<CTextFileLineRegExp>(pattern, caseSensitive);
+  }
+
+  Matcher(const Matcher &matcher) :
+   pattern_(matcher.pattern_), caseSensitive_(matcher.caseSensitive_) {
+    if (matcher.regexp_)
+      regexp_ = std::make_unique<CTextFileLineRegExp>(*matcher.regexp_);
+  }
+
+  // add non-overlapping matches in line to spans
+  void findAll(const std::string &line, Spans &spans) {
+    if (regexp_)
+      findAllRegExp(line, spans);
+    else
+      findAllLiteral(line, spans);
+  }
+
+ private:
+  Matcher &operator=(const Matcher &rhs);
+
+  void findAllRegExp(const std::string &line, Spans &spans) {
+    uint len = uint(line.size());
+
+    // match in place from each position on the whole line (no copy, and anchors and
+    // word boundaries see the chars before it)
+    uint pos = 0;
+
+    while (pos < len && regexp_->find(line, pos)) {
+      int spos, epos;
+
+      if (! regexp_->getMatchRange(&spos, &epos))
+        break;
+
+      // ignore empty match
+      if (epos >= spos)
+        spans.push_back(Span(uint(spos), uint(epos)));
+
+      pos = uint(epos >= spos ? epos + 1 : spos + 1);
+    }
+  }
+
+  void findAllLiteral(const std::string &line, Spans &spans) {
+    uint len  = uint(line.size());
+    uint plen = uint(pattern_.size());
+
+    uint pos = 0;
+
+    while (pos + plen <= len) {
+      int p = CTextFileStrSearch::findNext(&line[pos], len - pos, pattern_.c_str(), plen,
+                                           caseSensitive_);
+
+      if (p < 0)
+        break;
+
+      uint spos = pos + uint(p);
+
+      spans.push_back(Span(spos, spos + plen - 1));
+
+      pos = spos + plen;
+    }
+  }
+
+ private:
+  std::string                          pattern_;
+  bool                                 caseSensitive_ { true };
+  std::unique_ptr<CTextFileLineRegExp> regexp_;
+};
+
+//------
+
+CTextFileMatchSet::
+CTextFileMatchSet(CTextFile *file) :
+ file_(file)
+{
+  file_->addNotifier(this);
+}
+
+CTextFileMatchSet::
+~CTextFileMatchSet()
+{
+  cancelBuild();
+
+  file_->removeNotifier(this);
+}
+
+void
+CTextFileMatchSet::
+setPattern(const std::string &pattern, bool regexp, bool caseSensitive)
+{
+  if (state_ != State::NONE && pattern == pattern_ &&
+      regexp == regexp_ && caseSensitive == caseSensitive_)
+    return;
+
+  clear();
+
+  pattern_       = pattern;
+  regexp_        = regexp;
+  caseSensitive_ = caseSensitive;
+
+  if (pattern_.empty())
+    return;
+
+  matcher_ = std::make_shared<Matcher>(pattern_, regexp_, caseSensitive_);
+
+  rebuild();
+}
+
+void
+CTextFileMatchSet::
+clear()
+{
+  cancelBuild();
+
+  state_ = State::NONE;
+
+  pattern_ = "";
+  matcher_ = MatcherP();
+
+  lines_.clear();
+
+  numMatches_ = 0;
+}
+
+void
+CTextFileMatchSet::
+updateRows(uint row1, uint row2)
+{
+  if (state_ == State::NONE || noUndoChanged_)
+    return;
+
+  uint numLines = uint(lines_.size());
+
+  for (uint row = row1; row <= row2 && row < numLines; ++row) {
+    if (! lines_[row].matched)
+      matchLine(row);
+  }
+}
+
+const CTextFileMatchSet::Spans &
+CTextFileMatchSet::
+getLineSpans(uint row)
+{
+  static Spans noSpans;
+
+  if (state_ == State::NONE || noUndoChanged_ || row >= lines_.size())
+    return noSpans;
+
+  if (! lines_[row].matched)
+    matchLine(row);
+
+  return lines_[row].spans;
+}
+
+int
+CTextFileMatchSet::
+getNumMatches()
+{
+  if (! isComplete())
+    return -1;
+
+  return int(numMatches_);
+}
+
+bool
+CTextFileMatchSet::
+isComplete()
+{
+  if (state_ == State::BUILDING && buildDone_) {
+    buildThread_.join();
+
+    // too many edits made while matching so rematch
+    if (buildStale_) {
+      rebuild();
+
+      return false;
+    }
+
+    // replay edits made while matching (changed lines are unmatched)
+    bool valid = true;
+
+    for (const auto &edit : buildEdits_) {
+      if (edit.line_num + edit.n > buildLines_.size()) {
+        valid = false;
+        break;
+      }
+
+      auto p = buildLines_.begin() + edit.line_num;
+
+      p = buildLines_.erase(p, p + edit.n);
+
+      buildLines_.insert(p, edit.count, LineData());
+    }
+
+    buildEdits_.clear();
+
+    if (! valid || buildLines_.size() != lines_.size()) {
+      rebuild();
+
+      return false;
+    }
+
+    uint numLines = uint(lines_.size());
+
+    numMatches_ = 0;
+
+    for (uint i = 0; i < numLines; ++i) {
+      LineData &line = lines_[i];
+
+      if (! line.matched)
+        line = std::move(buildLines_[i]);
+
+      if (! line.matched)
+        matchLine(i);
+      else
+        numMatches_ += uint(line.spans.size());
+    }
+
+    buildLines_.clear();
+
+    state_ = State::COMPLETE;
+  }
+
+  return (state_ == State::COMPLETE);
+}
+
+void
+CTextFileMatchSet::
+rebuild()
+{
+  cancelBuild();
+
+  buildDone_ = false;
+
+  state_ = State::BUILDING;
+
+  lines_.assign(file_->getNumLines(), LineData());
+
+  numMatches_ = 0;
+
+  // lines are copied on write so snapshot lines can be read in the match thread
+  CTextFileSnapshot snapshot = file_->getSnapshot();
+
+  MatcherP matcher = std::make_shared<Matcher>(*matcher_);
+
+  buildThread_ = std::thread([this, matcher, lines = std::move(snapshot.lines)]() {
+    Lines lines1(lines.size());
+
+    uint numLines = uint(lines.size());
+
+    for (uint i = 0; i < numLines; ++i) {
+      if ((i & 0xfff) == 0 && buildCancel_)
+        return;
+
+      LineData &line = lines1[i];
+
+      matcher->findAll(lines[i]->getString(), line.spans);
+
+      line.matched = true;
+    }
+
+    buildLines_ = std::move(lines1);
+
+    buildDone_ = true;
+  });
+}
+
+void
+CTextFileMatchSet::
+cancelBuild()
+{
+  if (buildThread_.joinable()) {
+    buildCancel_ = true;
+
+    buildThread_.join();
+
+    buildCancel_ = false;
+  }
+
+  buildLines_.clear();
+  buildEdits_.clear();
+
+  buildStale_ = false;
+}
+
+void
+CTextFileMatchSet::
+matchLine(uint line_num)
+{
+  LineData &line = lines_[line_num];
+
+  if (line.matched)
+    numMatches_ -= uint(line.spans.size());
+
+  line.spans.clear();
+
+  matcher_->findAll(file_->getLine(line_num), line.spans);
+
+  line.matched = true;
+
+  numMatches_ += uint(line.spans.size());
+}
+
+void
+CTextFileMatchSet::
+fileOpened(const std::string &)
+{
+  if (state_ == State::NONE)
+    return;
+
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+    return;
+  }
+
+  rebuild();
+}
+
+void
+CTextFileMatchSet::
+lineAdded(const std::string &, uint line_num)
+{
+  if (state_ == State::NONE || line_num > lines_.size())
+    return;
+
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+    return;
+  }
+
+  lines_.insert(lines_.begin() + line_num, LineData());
+
+  matchLine(line_num);
+
+  addEdit(line_num, 0, 1);
+}
+
+void
+CTextFileMatchSet::
+lineDeleted(const std::string &, uint line_num)
+{
+  if (state_ == State::NONE || line_num >= lines_.size())
+    return;
+
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+    return;
+  }
+
+  numMatches_ -= uint(lines_[line_num].spans.size());
+
+  lines_.erase(lines_.begin() + line_num);
+
+  addEdit(line_num, 1, 0);
+}
+
+void
+CTextFileMatchSet::
+lineReplaced(const std::string &, const std::string &, uint line_num)
+{
+  lineChanged(line_num);
+}
+
+void
+CTextFileMatchSet::
+charAdded(char, uint line_num, uint)
+{
+  lineChanged(line_num);
+}
+
+void
+CTextFileMatchSet::
+charDeleted(char, uint line_num, uint)
+{
+  lineChanged(line_num);
+}
+
+void
+CTextFileMatchSet::
+charReplaced(char, char, uint line_num, uint)
+{
+  lineChanged(line_num);
+}
+
+void
+CTextFileMatchSet::
+linesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  if (state_ == State::NONE)
+    return;
+
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+    return;
+  }
+
+  uint n = uint(oldLines.size());
+
+  if (newLines.size() > s_maxEditLines || line_num + n > lines_.size()) {
+    rebuild();
+    return;
+  }
+
+  auto p = lines_.begin() + line_num;
+
+  for (uint i = 0; i < n; ++i)
+    numMatches_ -= uint(p[i].spans.size());
+
+  p = lines_.erase(p, p + n);
+
+  lines_.insert(p, newLines.size(), LineData());
+
+  uint numNew = uint(newLines.size());
+
+  for (uint i = 0; i < numNew; ++i)
+    matchLine(line_num + i);
+
+  addEdit(line_num, n, numNew);
+}
+
+void
+CTextFileMatchSet::
+startNoUndo()
+{
+  ++noUndoDepth_;
+}
+
+void
+CTextFileMatchSet::
+endNoUndo()
+{
+  assert(noUndoDepth_ > 0);
+
+  --noUndoDepth_;
+
+  // bulk edit (e.g. load) so rematch at end
+  if (noUndoDepth_ == 0 && noUndoChanged_) {
+    noUndoChanged_ = false;
+
+    if (state_ != State::NONE)
+      rebuild();
+  }
+}
+
+void
+CTextFileMatchSet::
+lineChanged(uint line_num)
+{
+  if (state_ == State::NONE || line_num >= lines_.size())
+    return;
+
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+    return;
+  }
+
+  matchLine(line_num);
+
+  addEdit(line_num, 1, 1);
+}
+
+void
+CTextFileMatchSet::
+addEdit(uint line_num, uint n, uint count)
+{
+  if (state_ != State::BUILDING)
+    return;
+
+  // drop log (and rematch when done) if too many edits
+  if (! buildStale_) {
+    if (buildEdits_.size() < s_maxBuildEdits) {
+      Edit edit;
+
+      edit.line_num = line_num;
+      edit.n        = n;
+      edit.count    = count;
+
+      buildEdits_.push_back(edit);
+    }
+    else {
+      buildEdits_.clear();
+
+      buildStale_ = true;
+    }
+  }
+
+  // merge finished match now so edits stop being logged
+  if (buildDone_)
+    isComplete();
+}
@@ -0,0 +1,99 @@
+#include <CTextFileRegExpCache.h>
+#include <algorithm>
+
+CTextFileRegExpCache *
+CTextFileRegExpCache::
+instance()
+{
+  // one cache per thread as a cached expression stores its last match
+  static thread_local CTextFileRegExpCache inst;
+
+  return &inst;
+}
+
+CTextFileRegExpCache::
+CTextFileRegExpCache()
+{
+}
+
+void
+CTextFileRegExpCache::
+setMaxSize(uint n)
+{
+  maxSize_ = std::max(n, 1U);
+
+  purge();
+}
+
+CRegExpP
+CTextFileRegExpCache::
+getRegExp(const std::string &pattern, bool caseSensitive)
+{
+  Entry &entry = getEntry(Key(pattern, caseSensitive));
+
+  if (! entry.regexp) {
+    entry.regexp = std::make_shared<CRegExp>(pattern);
+
+    entry.regexp->setCaseSensitive(caseSensitive);
+  }
+
+  return entry.regexp;
+}
+
+CTextFileLineRegExpP
+CTextFileRegExpCache::
+getLineRegExp(const std::string &pattern, bool caseSensitive)
+{
+  Entry &entry = getEntry(Key(pattern, caseSensitive));
+
+  if (! entry.lineRegexp)
+    entry.lineRegexp = std::make_shared<CTextFileLineRegExp>(pattern, caseSensitive);
+
+  return entry.lineRegexp;
+}
+
+CTextFileRegExpCache::Entry &
+CTextFileRegExpCache::
+getEntry(const Key &key)
+{
+  EntryMap::iterator p = entryMap_.find(key);
+
+  // move existing to front
+  if (p != entryMap_.end()) {
+    Entries::iterator pe = (*p).second;
+
+    if (pe != entries_.begin())
+      entries_.splice(entries_.begin(), entries_, pe);
+
+    return *pe;
+  }
+
+  // add new
+  entries_.push_front(Entry(key));
+
+  entryMap_[key] = entries_.begin();
+
+  purge();
+
+  return entries_.front();
+}
+
+void
+CTextFileRegExpCache::
+clear()
+{
+  entries_ .clear();
+  entryMap_.clear();
+}
+
+void
+CTextFileRegExpCache::
+purge()
+{
+  // remove least recently used
+  while (entries_.size() > maxSize_) {
+    entryMap_.erase(entries_.back().key);
+
+    entries_.pop_back();
+  }
+}
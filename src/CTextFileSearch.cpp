@@ -0,0 +1,692 @@
+#include <CTextFileSearch.h>
+#include <CTextFileSubst.h>
+#include <CTextFileTrigramIndex.h>
+#include <CTextFile.h>
+#include <CRegExp.h>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+uint s_numThreads = 0;
+uint s_minLines   = 65536;
+
+// Process wide pool of worker threads (created on first use) shared by all searches.
+//
+// A job runs proc(i) for i in [0, n). The calling thread also runs tasks of its own
+// job, so a job always completes even if all workers are busy (or the caller is itself
+// a worker). Tasks are claimed under the lock so a worker never touches a finished job.
+class WorkerPool {
+ public:
+  typedef std::function<void (uint)> Proc;
+
+ public:
+  static WorkerPool &instance() {
+    static WorkerPool pool;
+
+    return pool;
+  }
+
+ ~WorkerPool() {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      stop_ = true;
+    }
+
+    jobCond_.notify_all();
+
+    for (auto &thread : threads_)
+      thread.join();
+  }
+
+  void run(uint n, const Proc &proc) {
+    if (n <= 1) {
+      if (n == 1)
+        proc(0);
+
+      return;
+    }
+
+    Job job(n, proc);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      // one worker per extra thread (grows if number of threads is increased)
+      while (threads_.size() + 1 < CTextFileSearch::getNumThreads())
+        threads_.emplace_back([this]() { runWorker(); });
+
+      jobs_.push_back(&job);
+    }
+
+    jobCond_.notify_all();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    uint i;
+
+    while (claimTask(&job, &i)) {
+      lock.unlock();
+
+      proc(i);
+
+      lock.lock();
+
+      ++job.done;
+    }
+
+    doneCond_.wait(lock, [&job]() { return job.done >= job.n; });
+  }
+
+ private:
+  struct Job {
+    uint        n    { 0 };
+    const Proc &proc;
+    uint        next { 0 };
+    uint        done { 0 };
+
+    Job(uint n1, const Proc &proc1) : n(n1), proc(proc1) { }
+  };
+
+  WorkerPool() { }
+
+  // claim next task of job (mutex locked), job removed from queue when all claimed
+  bool claimTask(Job *job, uint *i) {
+    if (job->next >= job->n)
+      return false;
+
+    *i = job->next++;
+
+    if (job->next >= job->n) {
+      auto p = std::find(jobs_.begin(), jobs_.end(), job);
+
+      if (p != jobs_.end())
+        jobs_.erase(p);
+    }
+
+    return true;
+  }
+
+  void runWorker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+      jobCond_.wait(lock, [this]() { return stop_ || ! jobs_.empty(); });
+
+      if (stop_)
+        break;
+
+      Job *job = jobs_.front();
+
+      uint i;
+
+      if (! claimTask(job, &i))
+        continue;
+
+      lock.unlock();
+
+      job->proc(i);
+
+      lock.lock();
+
+      if (++job->done >= job->n)
+        doneCond_.notify_all();
+    }
+  }
+
+ private:
+  typedef std::deque<Job *>       Jobs;
+  typedef std::vector<std::thread> Threads;
+
+  std::mutex              mutex_;
+  std::condition_variable jobCond_;
+  std::condition_variable doneCond_;
+  Jobs                    jobs_;
+  Threads                 threads_;
+  bool                    stop_ { false };
+};
+
+}
+
+//------
+
+CTextFileSearch::
+CTextFileSearch(const CTextFile *file, const CTextFileUtil *util) :
+ file_(file), util_(util)
+{
+}
+
+CTextFileSearch::
+CTextFileSearch(const CTextLineList *lines, const CTextFileUtil *util) :
+ lines_(lines), util_(util)
+{
+}
+
+uint
+CTextFileSearch::
+getNumThreads()
+{
+  if (s_numThreads > 0)
+    return s_numThreads;
+
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+void
+CTextFileSearch::
+setNumThreads(uint n)
+{
+  s_numThreads = n;
+}
+
+uint
+CTextFileSearch::
+getMinLines()
+{
+  return s_minLines;
+}
+
+void
+CTextFileSearch::
+setMinLines(uint n)
+{
+  s_minLines = n;
+}
+
+void
+CTextFileSearch::
+runParallel(uint n, const std::function<void (uint)> &proc)
+{
+  WorkerPool::instance().run(n, proc);
+}
+
+bool
+CTextFileSearch::
+isParallel(int line_num1, int line_num2)
+{
+  if (line_num1 < 0 || line_num2 < line_num1)
+    return false;
+
+  return (uint(line_num2 - line_num1 + 1) >= getMinLines() && getNumThreads() > 1);
+}
+
+bool
+CTextFileSearch::
+findNext(const std::string &pattern, uint line_num1, uint line_num2,
+         uint *fline_num, uint *fchar_num, bool caseSensitive) const
+{
+  const CTextFileUtil *util = util_;
+
+  auto factory = [&]() {
+    return LineMatcher([util, &pattern, caseSensitive](const std::string &line,
+                                                       uint *spos, uint *) {
+      return util->lineFindNext(line, pattern, 0, -1, spos, caseSensitive);
+    });
+  };
+
+  uint epos;
+
+  return findLines(factory, line_num1, line_num2, true, fline_num, fchar_num, &epos);
+}
+
+bool
+CTextFileSearch::
+findNext(const CRegExp &pattern, uint line_num1, uint line_num2,
+         uint *fline_num, uint *spos, uint *epos) const
+{
+  const CTextFileUtil *util = util_;
+
+  auto factory = [&]() {
+    auto regexp = std::make_shared<CRegExp>(pattern);
+
+    return LineMatcher([util, regexp](const std::string &line, uint *spos1, uint *epos1) {
+      return util->lineFindNext(line, *regexp, 0, -1, spos1, epos1);
+    });
+  };
+
+  return findLines(factory, line_num1, line_num2, true, fline_num, spos, epos);
+}
+
+bool
+CTextFileSearch::
+findPrev(const std::string &pattern, uint line_num1, uint line_num2,
+         uint *fline_num, uint *fchar_num, bool caseSensitive) const
+{
+  const CTextFileUtil *util = util_;
+
+  auto factory = [&]() {
+    return LineMatcher([util, &pattern, caseSensitive](const std::string &line,
+                                                       uint *spos, uint *) {
+      return util->lineFindPrev(line, pattern, -1, 0, spos, caseSensitive);
+    });
+  };
+
+  uint epos;
+
+  return findLines(factory, line_num1, line_num2, false, fline_num, fchar_num, &epos);
+}
+
+bool
+CTextFileSearch::
+findPrev(const CRegExp &pattern, uint line_num1, uint line_num2,
+         uint *fline_num, uint *spos, uint *epos) const
+{
+  const CTextFileUtil *util = util_;
+
+  auto factory = [&]() {
+    auto regexp = std::make_shared<CRegExp>(pattern);
+
+    return LineMatcher([util, regexp](const std::string &line, uint *spos1, uint *epos1) {
+      return util->lineFindPrev(line, *regexp, -1, 0, spos1, epos1);
+    });
+  };
+
+  return findLines(factory, line_num1, line_num2, false, fline_num, spos, epos);
+}
+
+bool
+CTextFileSearch::
+findLines(const LineMatcherFactory &factory, uint line_num1, uint line_num2,
+          bool forward, uint *fline_num, uint *spos, uint *epos) const
+{
+  if (line_num2 < line_num1)
+    return false;
+
+  uint numLines   = line_num2 - line_num1 + 1;
+  uint numThreads = std::min(getNumThreads(), std::max(1U, numLines/1024));
+
+  // small chunks so an early match stops the other workers quickly
+  uint chunkSize = std::max(1024U, numLines/(16*numThreads));
+  uint numChunks = (numLines + chunkSize - 1)/chunkSize;
+
+  struct Match {
+    uint line_num { 0 };
+    uint spos     { 0 };
+    uint epos     { 0 };
+  };
+
+  std::vector<Match> matches(numChunks);
+
+  std::atomic<uint> nextChunk { 0 };
+  std::atomic<uint> bestChunk { numChunks };
+
+  // chunks are numbered in search order and claimed in that order
+  auto worker = [&]() {
+    LineMatcher matcher = factory();
+
+    CTextFileTrigramIndex::Scan scan(index_, sig_, forward);
+
+    while (true) {
+      uint chunk = nextChunk++;
+
+      if (chunk >= numChunks || chunk > bestChunk)
+        break;
+
+      uint offset1 = chunk*chunkSize;
+      uint offset2 = std::min(offset1 + chunkSize, numLines);
+
+      for (uint offset = offset1; offset < offset2; ++offset) {
+        // nearer chunk already matched
+        if ((offset & 0xff) == 0 && bestChunk < chunk)
+          return;
+
+        uint line_num = (forward ? line_num1 + offset : line_num2 - offset);
+
+        // skip to next block of lines which can match
+        int line_num3 = scan.nextLine(int(line_num));
+
+        if (line_num3 < 0)
+          break;
+
+        if (uint(line_num3) != line_num) {
+          offset = (forward ? uint(line_num3) - line_num1 : line_num2 - uint(line_num3)) - 1;
+          continue;
+        }
+
+        uint spos1, epos1;
+
+        if (! matcher(getLine(line_num), &spos1, &epos1))
+          continue;
+
+        Match &match = matches[chunk];
+
+        match.line_num = line_num;
+        match.spos     = spos1;
+        match.epos     = epos1;
+
+        uint best = bestChunk;
+
+        while (chunk < best && ! bestChunk.compare_exchange_weak(best, chunk))
+          ;
+
+        break;
+      }
+    }
+  };
+
+  runParallel(numThreads, [&](uint) { worker(); });
+
+  if (bestChunk >= numChunks)
+    return false;
+
+  const Match &match = matches[bestChunk];
+
+  *fline_num = match.line_num;
+  *spos      = match.spos;
+  *epos      = match.epos;
+
+  return true;
+}
+
+void
+CTextFileSearch::
+matchLines(const CRegExp &pattern, uint line_num1, uint line_num2,
+           bool invert, LineNums &lines) const
+{
+  lines.clear();
+
+  if (line_num2 < line_num1)
+    return;
+
+  uint chunkSize;
+
+  uint numChunks = getNumChunks(line_num1, line_num2, &chunkSize);
+
+  std::vector<LineNums> chunkLines(numChunks);
+
+  auto factory = [&]() {
+    auto regexp = std::make_shared<CRegExp>(pattern);
+
+    return ChunkProc([&, regexp](uint chunk, uint line_num3, uint line_num4) {
+      LineNums &lines1 = chunkLines[chunk];
+
+      // next line which can match (lines of skipped blocks don't match)
+      CTextFileTrigramIndex::Scan scan(index_, sig_);
+
+      int line_num5 = scan.nextLine(int(line_num3));
+
+      for (uint line_num = line_num3; line_num <= line_num4; ++line_num) {
+        if (line_num5 >= 0 && uint(line_num5) < line_num)
+          line_num5 = scan.nextLine(int(line_num));
+
+        bool match = (uint(line_num5) == line_num &&
+                      util_->lineFindNext(getLine(line_num), *regexp, 0, -1,
+                                          nullptr, nullptr));
+
+        if (match != invert)
+          lines1.push_back(line_num);
+      }
+    });
+  };
+
+  processChunks(factory, line_num1, line_num2);
+
+  for (const auto &lines1 : chunkLines)
+    lines.insert(lines.end(), lines1.begin(), lines1.end());
+}
+
+void
+CTextFileSearch::
+substLines(const CTextFileSubst &subst, uint line_num1, uint line_num2,
+           CTextFileUtil::LineEdits &edits) const
+{
+  edits.clear();
+
+  if (line_num2 < line_num1)
+    return;
+
+  uint chunkSize;
+
+  uint numChunks = getNumChunks(line_num1, line_num2, &chunkSize);
+
+  std::vector<CTextFileUtil::LineEdits> chunkEdits(numChunks);
+
+  auto factory = [&]() {
+    auto subst1 = std::make_shared<CTextFileSubst>(subst);
+
+    return ChunkProc([&, subst1](uint chunk, uint line_num3, uint line_num4) {
+      CTextFileUtil::LineEdits &edits1 = chunkEdits[chunk];
+
+      CTextFileUtil::LineEdit edit;
+
+      // skip blocks of lines which can't match
+      CTextFileTrigramIndex::Scan scan(index_, sig_);
+
+      for (int line_num5 = scan.nextLine(int(line_num3));
+           line_num5 >= 0 && uint(line_num5) <= line_num4;
+           line_num5 = scan.nextLine(line_num5 + 1)) {
+        uint line_num = uint(line_num5);
+
+        if (! subst1->substLine(getLine(line_num), edit.line))
+          continue;
+
+        edit.line_num = line_num;
+
+        edits1.push_back(std::move(edit));
+      }
+    });
+  };
+
+  processChunks(factory, line_num1, line_num2);
+
+  if (numChunks == 1) {
+    edits = std::move(chunkEdits[0]);
+    return;
+  }
+
+  size_t numEdits = 0;
+
+  for (const auto &edits1 : chunkEdits)
+    numEdits += edits1.size();
+
+  edits.reserve(numEdits);
+
+  for (auto &edits1 : chunkEdits)
+    std::move(edits1.begin(), edits1.end(), std::back_inserter(edits));
+}
+
+bool
+CTextFileSearch::
+countLines(const CRegExp &pattern, uint line_num1, uint line_num2, bool invert,
+           uint maxLines, Count &count) const
+{
+  count = Count();
+
+  if (line_num2 < line_num1)
+    return true;
+
+  uint chunkSize;
+
+  uint numChunks = getNumChunks(line_num1, line_num2, &chunkSize);
+
+  std::vector<Count> chunkCounts(numChunks);
+
+  auto factory = [&]() {
+    auto regexp = std::make_shared<CRegExp>(pattern);
+
+    return ChunkProc([&, regexp](uint chunk, uint line_num3, uint line_num4) {
+      Count &count1 = chunkCounts[chunk];
+
+      // next line which can match (lines of skipped blocks don't match)
+      CTextFileTrigramIndex::Scan scan(index_, sig_);
+
+      int line_num5 = scan.nextLine(int(line_num3));
+
+      for (uint line_num = line_num3; line_num <= line_num4; ++line_num) {
+        if ((line_num & 0xfff) == 0 && isCancelled())
+          return;
+
+        if (line_num5 >= 0 && uint(line_num5) < line_num)
+          line_num5 = scan.nextLine(int(line_num));
+
+        const std::string &line = getLine(line_num);
+
+        bool match = (uint(line_num5) == line_num &&
+                      util_->lineFindNext(line, *regexp, 0, -1, nullptr, nullptr));
+
+        if (match == invert)
+          continue;
+
+        ++count1.numLines;
+
+        if (count1.lines.size() < maxLines) {
+          CTextFileUtil::LineEdit edit;
+
+          edit.line_num = line_num;
+          edit.line     = line;
+
+          count1.lines.push_back(std::move(edit));
+        }
+      }
+
+      count1.numMatches = count1.numLines;
+    });
+  };
+
+  processChunks(factory, line_num1, line_num2);
+
+  if (isCancelled())
+    return false;
+
+  joinCounts(chunkCounts, maxLines, count);
+
+  return true;
+}
+
+bool
+CTextFileSearch::
+countSubst(const CTextFileSubst &subst, uint line_num1, uint line_num2,
+           uint maxLines, Count &count) const
+{
+  count = Count();
+
+  if (line_num2 < line_num1)
+    return true;
+
+  uint chunkSize;
+
+  uint numChunks = getNumChunks(line_num1, line_num2, &chunkSize);
+
+  std::vector<Count> chunkCounts(numChunks);
+
+  auto factory = [&]() {
+    auto subst1 = std::make_shared<CTextFileSubst>(subst);
+
+    return ChunkProc([&, subst1](uint chunk, uint line_num3, uint line_num4) {
+      Count &count1 = chunkCounts[chunk];
+
+      CTextFileUtil::LineEdit edit;
+
+      // skip blocks of lines which can't match
+      CTextFileTrigramIndex::Scan scan(index_, sig_);
+
+      for (int line_num5 = scan.nextLine(int(line_num3));
+           line_num5 >= 0 && uint(line_num5) <= line_num4;
+           line_num5 = scan.nextLine(line_num5 + 1)) {
+        uint line_num = uint(line_num5);
+
+        if ((line_num & 0xfff) == 0 && isCancelled())
+          return;
+
+        uint n = subst1->substLine(getLine(line_num), edit.line);
+
+        if (! n)
+          continue;
+
+        ++count1.numLines;
+
+        count1.numMatches += n;
+
+        if (count1.lines.size() < maxLines) {
+          edit.line_num = line_num;
+
+          count1.lines.push_back(std::move(edit));
+        }
+      }
+    });
+  };
+
+  processChunks(factory, line_num1, line_num2);
+
+  if (isCancelled())
+    return false;
+
+  joinCounts(chunkCounts, maxLines, count);
+
+  return true;
+}
+
+void
+CTextFileSearch::
+joinCounts(std::vector<Count> &chunkCounts, uint maxLines, Count &count)
+{
+  for (auto &count1 : chunkCounts) {
+    count.numLines   += count1.numLines;
+    count.numMatches += count1.numMatches;
+
+    for (auto &edit : count1.lines) {
+      if (count.lines.size() >= maxLines)
+        break;
+
+      count.lines.push_back(std::move(edit));
+    }
+  }
+}
+
+uint
+CTextFileSearch::
+getNumChunks(uint line_num1, uint line_num2, uint *chunkSize) const
+{
+  uint numLines = line_num2 - line_num1 + 1;
+
+  // whole range in one chunk if too small for threads
+  if (! isParallel(int(line_num1), int(line_num2))) {
+    *chunkSize = numLines;
+
+    return 1;
+  }
+
+  // a few chunks per thread to balance uneven lines
+  *chunkSize = std::max(1024U, numLines/(4*getNumThreads()));
+
+  return (numLines + *chunkSize - 1)/(*chunkSize);
+}
+
+void
+CTextFileSearch::
+processChunks(const ChunkProcFactory &factory, uint line_num1, uint line_num2) const
+{
+  uint chunkSize;
+
+  uint numChunks = getNumChunks(line_num1, line_num2, &chunkSize);
+
+  uint numThreads = std::min(getNumThreads(), numChunks);
+
+  std::atomic<uint> nextChunk { 0 };
+
+  auto worker = [&]() {
+    ChunkProc proc = factory();
+
+    while (true) {
+      uint chunk = nextChunk++;
+
+      if (chunk >= numChunks)
+        break;
+
+      uint line_num3 = line_num1 + chunk*chunkSize;
+      uint line_num4 = std::min(line_num3 + chunkSize - 1, line_num2);
+
+      proc(chunk, line_num3, line_num4);
+    }
+  };
+
+  runParallel(numThreads, [&](uint) { worker(); });
+}
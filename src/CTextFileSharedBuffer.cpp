@@ -0,0 +1,315 @@
+#include <CTextFileSharedBuffer.h>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char s_magic[8] = { 'C', 'T', 'F', 'B', 'U', 'F', '1', '\0' };
+
+// segment layout: header, line offsets (numLines + 1), newline flags (numLines), text
+struct Header {
+  char     magic[8];
+  uint64_t seq;
+  uint64_t numLines;
+  uint64_t textSize;
+};
+
+size_t segmentSize(uint64_t numLines, uint64_t textSize)
+{
+  return sizeof(Header) + (numLines + 1)*sizeof(uint64_t) + numLines + textSize;
+}
+
+// open segment fd locked (shared or exclusive) and closed (unlocked) on destruction
+class LockedFd {
+ public:
+  LockedFd(const std::string &name, bool write) {
+    fd_ = shm_open(name.c_str(), write ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+
+    if (fd_ < 0) {
+      // no segment is not an error for a reader (empty buffer)
+      if (write || errno != ENOENT)
+        error_ = "Failed to open '" + name + "': " + strerror(errno);
+
+      return;
+    }
+
+    // segment must be owned by, and only accessible to, the user (the name is
+    // predictable so it may have been created by another user)
+    struct stat st;
+
+    if (fstat(fd_, &st) != 0 || st.st_uid != getuid() || (st.st_mode & 077) != 0) {
+      error_ = "Buffer '" + name + "' is not private to user";
+
+      close(fd_);
+
+      fd_ = -1;
+
+      return;
+    }
+
+    if (flock(fd_, write ? LOCK_EX : LOCK_SH) != 0) {
+      error_ = "Failed to lock '" + name + "': " + strerror(errno);
+
+      close(fd_);
+
+      fd_ = -1;
+    }
+  }
+
+ ~LockedFd() {
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+  int fd() const { return fd_; }
+
+  bool isValid() const { return (fd_ >= 0); }
+
+  // reason not valid (empty if no segment to read)
+  const std::string &error() const { return error_; }
+
+  // size of segment (0 on error)
+  size_t size() const {
+    struct stat st;
+
+    if (fstat(fd_, &st) != 0)
+      return 0;
+
+    return size_t(st.st_size);
+  }
+
+  bool readHeader(Header &header) const {
+    if (size() < sizeof(Header))
+      return false;
+
+    if (pread(fd_, &header, sizeof(header), 0) != ssize_t(sizeof(header)))
+      return false;
+
+    return (memcmp(header.magic, s_magic, sizeof(s_magic)) == 0);
+  }
+
+ private:
+  LockedFd(const LockedFd &rhs);
+  LockedFd &operator=(const LockedFd &rhs);
+
+ private:
+  int         fd_ { -1 };
+  std::string error_;
+};
+
+}
+
+//------
+
+CTextFileSharedBuffer::
+CTextFileSharedBuffer(char id)
+{
+  char name[64];
+
+  snprintf(name, sizeof(name), "/CTextFileBuffer.%u.%02x",
+           uint(getuid()), uint(static_cast<unsigned char>(id)));
+
+  name_ = name;
+}
+
+uint64_t
+CTextFileSharedBuffer::
+write(const CTextLineList &lines, const NewLines &newlines)
+{
+  error_ = "";
+
+  LockedFd fd(name_, /*write*/true);
+
+  if (! fd.isValid()) {
+    error_ = fd.error();
+    return 0;
+  }
+
+  // new sequence number (later than previous contents, and unique if segment recreated)
+  Header header;
+
+  uint64_t seq = 0;
+
+  if (fd.readHeader(header))
+    seq = header.seq;
+
+  uint64_t t = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch()).count());
+
+  seq = std::max(seq + 1, t);
+
+  //---
+
+  uint64_t numLines = lines.size();
+  uint64_t textSize = 0;
+
+  for (const auto &line : lines)
+    textSize += line->getLength();
+
+  size_t size = segmentSize(numLines, textSize);
+
+  if (ftruncate(fd.fd(), off_t(size)) != 0) {
+    error_ = "Failed to resize '" + name_ + "': " + strerror(errno);
+    return 0;
+  }
+
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.fd(), 0);
+
+  if (data == MAP_FAILED) {
+    error_ = "Failed to map '" + name_ + "': " + strerror(errno);
+    return 0;
+  }
+
+  char *p = static_cast<char *>(data);
+
+  // header is invalid until contents written
+  memset(p, 0, sizeof(Header));
+
+  uint64_t *offsets = reinterpret_cast<uint64_t *>(p + sizeof(Header));
+  char     *flags   = reinterpret_cast<char *>(offsets + numLines + 1);
+  char     *text    = flags + numLines;
+
+  uint64_t offset = 0;
+
+  for (uint64_t i = 0; i < numLines; ++i) {
+    const std::string &str = lines[i]->getString();
+
+    offsets[i] = offset;
+    flags  [i] = (i < newlines.size() && newlines[i] ? 1 : 0);
+
+    memcpy(text + offset, str.data(), str.size());
+
+    offset += str.size();
+  }
+
+  offsets[numLines] = offset;
+
+  memcpy(header.magic, s_magic, sizeof(s_magic));
+
+  header.seq      = seq;
+  header.numLines = numLines;
+  header.textSize = textSize;
+
+  memcpy(p, &header, sizeof(header));
+
+  munmap(data, size);
+
+  return seq;
+}
+
+uint64_t
+CTextFileSharedBuffer::
+getSeq() const
+{
+  error_ = "";
+
+  LockedFd fd(name_, /*write*/false);
+
+  if (! fd.isValid()) {
+    error_ = fd.error();
+    return 0;
+  }
+
+  Header header;
+
+  if (! fd.readHeader(header))
+    return 0;
+
+  return header.seq;
+}
+
+bool
+CTextFileSharedBuffer::
+read(CTextFile *file, CTextLineList &lines, NewLines &newlines, uint64_t *seq) const
+{
+  error_ = "";
+
+  lines   .clear();
+  newlines.clear();
+
+  *seq = 0;
+
+  // no segment is an empty buffer
+  LockedFd fd(name_, /*write*/false);
+
+  if (! fd.isValid()) {
+    error_ = fd.error();
+    return false;
+  }
+
+  Header header;
+
+  if (! fd.readHeader(header))
+    return false;
+
+  size_t size = fd.size();
+
+  if (header.numLines > size || header.textSize > size ||
+      segmentSize(header.numLines, header.textSize) > size) {
+    error_ = "Invalid buffer '" + name_ + "'";
+    return false;
+  }
+
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.fd(), 0);
+
+  if (data == MAP_FAILED) {
+    error_ = "Failed to map '" + name_ + "': " + strerror(errno);
+    return false;
+  }
+
+  const char *p = static_cast<const char *>(data);
+
+  uint64_t numLines = header.numLines;
+
+  const uint64_t *offsets = reinterpret_cast<const uint64_t *>(p + sizeof(Header));
+  const char     *flags   = reinterpret_cast<const char *>(offsets + numLines + 1);
+  const char     *text    = flags + numLines;
+
+  lines   .reserve(numLines);
+  newlines.reserve(numLines);
+
+  bool valid = true;
+
+  for (uint64_t i = 0; i < numLines; ++i) {
+    uint64_t offset1 = offsets[i];
+    uint64_t offset2 = offsets[i + 1];
+
+    if (offset1 > offset2 || offset2 > header.textSize) {
+      valid = false;
+      break;
+    }
+
+    lines   .push_back(file->createLine(std::string(text + offset1, offset2 - offset1)));
+    newlines.push_back(flags[i] != 0);
+  }
+
+  munmap(data, size);
+
+  if (! valid) {
+    lines   .clear();
+    newlines.clear();
+
+    error_ = "Invalid buffer '" + name_ + "'";
+
+    return false;
+  }
+
+  *seq = header.seq;
+
+  return true;
+}
+
+void
+CTextFileSharedBuffer::
+remove()
+{
+  shm_unlink(name_.c_str());
+}
@@ -0,0 +1,346 @@
+#include <CTextFileSort.h>
+#include <CTextFileRegExpCache.h>
+#include <CTextFileSearch.h>
+#include <CRegExp.h>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// lines below which radix sort is not worth its counts
+const uint s_minRadixLines = 1024;
+
+// number of threads for n items (same threshold as search)
+uint numThreadsFor(uint n)
+{
+  if (! CTextFileSearch::isParallel(0, int(n) - 1))
+    return 1;
+
+  return std::min(CTextFileSearch::getNumThreads(), n);
+}
+
+int compareNoCase(std::string_view str1, std::string_view str2)
+{
+  size_t len = std::min(str1.size(), str2.size());
+
+  for (size_t i = 0; i < len; ++i) {
+    int c1 = tolower(static_cast<unsigned char>(str1[i]));
+    int c2 = tolower(static_cast<unsigned char>(str2[i]));
+
+    if (c1 != c2)
+      return (c1 < c2 ? -1 : 1);
+  }
+
+  if (str1.size() == str2.size())
+    return 0;
+
+  return (str1.size() < str2.size() ? -1 : 1);
+}
+
+// key of first decimal number in str (optional leading '-') ordered as unsigned,
+// 0 (before all numbers) if no number
+uint64_t numberKey(std::string_view str)
+{
+  size_t len = str.size();
+  size_t i   = 0;
+
+  while (i < len && ! isdigit(static_cast<unsigned char>(str[i])))
+    ++i;
+
+  if (i >= len)
+    return 0;
+
+  bool negative = (i > 0 && str[i - 1] == '-');
+
+  // saturate large numbers
+  const uint64_t maxValue = uint64_t(INT64_MAX);
+
+  uint64_t value = 0;
+
+  for ( ; i < len && isdigit(static_cast<unsigned char>(str[i])); ++i) {
+    uint d = uint(str[i] - '0');
+
+    if (value > (maxValue - d)/10)
+      value = maxValue;
+    else
+      value = value*10 + d;
+  }
+
+  // flip sign bit so signed order is unsigned order (min value reserved for no number)
+  int64_t ivalue = (negative ? -int64_t(value) : int64_t(value));
+
+  return uint64_t(ivalue) ^ (uint64_t(1) << 63);
+}
+
+}
+
+//------
+
+CTextFileSort::
+CTextFileSort(CTextFile *file) :
+ file_(file)
+{
+}
+
+bool
+CTextFileSort::
+sort(uint line_num1, uint line_num2)
+{
+  numRemoved_ = 0;
+
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num2 >= numLines)
+    return false;
+
+  uint n = line_num2 - line_num1 + 1;
+
+  // lines are shared so key views stay valid until they are replaced
+  CTextLineList lines = file_->getLines(line_num1, n);
+
+  makeKeys(lines);
+
+  Indices inds(n);
+
+  for (uint i = 0; i < n; ++i)
+    inds[i] = i;
+
+  if (numeric_)
+    sortNumeric(inds);
+  else
+    sortText(inds);
+
+  //---
+
+  // keep first of lines with equal keys
+  if (unique_) {
+    uint n1 = 0;
+
+    for (uint i = 0; i < n; ++i) {
+      if (n1 > 0 && equalKeys(inds[n1 - 1], inds[i]))
+        continue;
+
+      inds[n1++] = inds[i];
+    }
+
+    numRemoved_ = n - n1;
+
+    inds.resize(n1);
+  }
+
+  //---
+
+  bool changed = (numRemoved_ > 0);
+
+  for (uint i = 0; ! changed && i < inds.size(); ++i)
+    changed = (inds[i] != i);
+
+  if (! changed) {
+    textKeys_   .clear();
+    numericKeys_.clear();
+
+    return false;
+  }
+
+  CTextLineList newLines;
+
+  newLines.reserve(inds.size());
+
+  for (uint i : inds)
+    newLines.push_back(lines[i]);
+
+  textKeys_   .clear();
+  numericKeys_.clear();
+
+  file_->spliceLines(line_num1, n, newLines);
+
+  return true;
+}
+
+void
+CTextFileSort::
+makeKeys(const CTextLineList &lines)
+{
+  uint n = uint(lines.size());
+
+  textKeys_   .clear();
+  numericKeys_.clear();
+
+  if (numeric_)
+    numericKeys_.resize(n);
+  else
+    textKeys_.resize(n);
+
+  // keys of lines are independent so are found in parallel chunks
+  uint numThreads = numThreadsFor(n);
+
+  uint chunkSize = (n + numThreads - 1)/numThreads;
+
+  CTextFileSearch::runParallel(numThreads, [&](uint chunk) {
+    // each thread has its own regexp cache (a regexp stores its last match)
+    CRegExpP regexp;
+
+    if (! pattern_.empty())
+      regexp = CTextFileRegExpCacheInst->getRegExp(pattern_, caseSensitive_);
+
+    uint i1 = chunk*chunkSize;
+    uint i2 = std::min(i1 + chunkSize, n);
+
+    for (uint i = i1; i < i2; ++i) {
+      std::string_view key = getKey(lines[i]->getString(), regexp.get());
+
+      if (numeric_) {
+        uint64_t key1 = numberKey(key);
+
+        // reverse order of keys (equal keys keep their order)
+        numericKeys_[i] = (reverse_ ? ~key1 : key1);
+      }
+      else
+        textKeys_[i] = key;
+    }
+  });
+}
+
+std::string_view
+CTextFileSort::
+getKey(const std::string &line, const CRegExp *regexp) const
+{
+  std::string_view key(line);
+
+  if (! regexp)
+    return key;
+
+  // text after match (empty if no match)
+  int spos, epos;
+
+  if (! regexp->find(line) || ! regexp->getMatchRange(&spos, &epos))
+    return std::string_view();
+
+  size_t pos = size_t(std::max(epos + 1, spos));
+
+  return key.substr(std::min(pos, key.size()));
+}
+
+void
+CTextFileSort::
+sortText(Indices &inds) const
+{
+  uint n = uint(inds.size());
+
+  auto less = [this](uint i1, uint i2) { return lessText(i1, i2); };
+
+  uint numThreads = numThreadsFor(n);
+
+  if (numThreads <= 1) {
+    std::stable_sort(inds.begin(), inds.end(), less);
+    return;
+  }
+
+  // sort a run per thread
+  uint runSize = (n + numThreads - 1)/numThreads;
+
+  Indices starts;
+
+  for (uint i = 0; i < n; i += runSize)
+    starts.push_back(i);
+
+  starts.push_back(n);
+
+  uint numRuns = uint(starts.size()) - 1;
+
+  CTextFileSearch::runParallel(numRuns, [&](uint run) {
+    std::stable_sort(inds.begin() + starts[run], inds.begin() + starts[run + 1], less);
+  });
+
+  // merge pairs of adjacent runs (in parallel) until one run is left. Merge takes
+  // equal keys from the first run so the sort stays stable
+  Indices buffer(n);
+
+  while (numRuns > 1) {
+    uint numPairs = (numRuns + 1)/2;
+
+    CTextFileSearch::runParallel(numPairs, [&](uint pair) {
+      uint i1 = starts[2*pair];
+      uint i2 = starts[std::min(2*pair + 1, numRuns)];
+      uint i3 = starts[std::min(2*pair + 2, numRuns)];
+
+      std::merge(inds.begin() + i1, inds.begin() + i2, inds.begin() + i2, inds.begin() + i3,
+                 buffer.begin() + i1, less);
+    });
+
+    Indices starts1;
+
+    for (uint run = 0; run < numRuns; run += 2)
+      starts1.push_back(starts[run]);
+
+    starts1.push_back(n);
+
+    inds  .swap(buffer);
+    starts.swap(starts1);
+
+    numRuns = uint(starts.size()) - 1;
+  }
+}
+
+void
+CTextFileSort::
+sortNumeric(Indices &inds) const
+{
+  uint n = uint(inds.size());
+
+  if (n < s_minRadixLines) {
+    std::stable_sort(inds.begin(), inds.end(), [this](uint i1, uint i2) {
+      return numericKeys_[i1] < numericKeys_[i2]; });
+    return;
+  }
+
+  // LSD radix sort on 16 bit digits (stable)
+  Indices buffer(n);
+
+  std::vector<uint> counts(65537);
+
+  for (uint shift = 0; shift < 64; shift += 16) {
+    std::fill(counts.begin(), counts.end(), 0);
+
+    for (uint i : inds)
+      ++counts[((numericKeys_[i] >> shift) & 0xffff) + 1];
+
+    // skip digit if same for all keys (common for high digits)
+    if (std::find(counts.begin(), counts.end(), n) != counts.end())
+      continue;
+
+    for (uint d = 1; d <= 65536; ++d)
+      counts[d] += counts[d - 1];
+
+    for (uint i : inds)
+      buffer[counts[(numericKeys_[i] >> shift) & 0xffff]++] = i;
+
+    inds.swap(buffer);
+  }
+}
+
+bool
+CTextFileSort::
+lessText(uint i1, uint i2) const
+{
+  if (reverse_)
+    std::swap(i1, i2);
+
+  if (caseSensitive_)
+    return (textKeys_[i1] < textKeys_[i2]);
+  else
+    return (compareNoCase(textKeys_[i1], textKeys_[i2]) < 0);
+}
+
+bool
+CTextFileSort::
+equalKeys(uint i1, uint i2) const
+{
+  if (numeric_)
+    return (numericKeys_[i1] == numericKeys_[i2]);
+
+  if (caseSensitive_)
+    return (textKeys_[i1] == textKeys_[i2]);
+  else
+    return (compareNoCase(textKeys_[i1], textKeys_[i2]) == 0);
+}
@@ -0,0 +1,233 @@
+#include <CTextFileStrSearch.h>
+#include <cctype>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline char lowerChar(char c)
+{
+  return char(tolower((unsigned char) c));
+}
+
+// bits to or into text chars so letters compare case insensitively
+inline char caseMask(char c, bool caseSensitive)
+{
+  return ((! caseSensitive && isalpha((unsigned char) c)) ? 0x20 : 0);
+}
+
+inline bool equalChars(const char *str1, const char *str2, uint n, bool caseSensitive)
+{
+  if (caseSensitive)
+    return (memcmp(str1, str2, n) == 0);
+
+  for (uint i = 0; i < n; ++i)
+    if (lowerChar(str1[i]) != lowerChar(str2[i]))
+      return false;
+
+  return true;
+}
+
+// check candidate start positions [pos1, pos2] in increasing order
+int scalarFindNext(const char *str, uint len, const char *pattern, uint plen,
+                   bool caseSensitive, uint pos1)
+{
+  if (caseSensitive) {
+    const void *p = memmem(str + pos1, len - pos1, pattern, plen);
+
+    return (p ? int((const char *) p - str) : -1);
+  }
+
+  char c = lowerChar(pattern[0]);
+
+  for (uint i = pos1; i + plen <= len; ++i) {
+    if (lowerChar(str[i]) == c && equalChars(str + i, pattern, plen, false))
+      return int(i);
+  }
+
+  return -1;
+}
+
+// check candidate start positions [0, pos2] in decreasing order
+int scalarFindPrev(const char *str, const char *pattern, uint plen,
+                   bool caseSensitive, int pos2)
+{
+  char c = (caseSensitive ? pattern[0] : lowerChar(pattern[0]));
+
+  for (int i = pos2; i >= 0; --i) {
+    char c1 = (caseSensitive ? str[i] : lowerChar(str[i]));
+
+    if (c1 == c && equalChars(str + i, pattern, plen, caseSensitive))
+      return i;
+  }
+
+  return -1;
+}
+
+#ifdef __SSE2__
+class SSE2Block {
+ public:
+  static const uint width = 16;
+
+  SSE2Block(const char *pattern, uint plen, bool caseSensitive) {
+    char c1 = pattern[0], c2 = pattern[plen - 1];
+
+    if (! caseSensitive) {
+      c1 = lowerChar(c1);
+      c2 = lowerChar(c2);
+    }
+
+    first_   = _mm_set1_epi8(c1);
+    last_    = _mm_set1_epi8(c2);
+    firstOr_ = _mm_set1_epi8(caseMask(c1, caseSensitive));
+    lastOr_  = _mm_set1_epi8(caseMask(c2, caseSensitive));
+  }
+
+  // bit mask of positions in block whose first and last chars match
+  uint mask(const char *str, uint plen) const {
+    __m128i s1 = _mm_loadu_si128((const __m128i *) str);
+    __m128i s2 = _mm_loadu_si128((const __m128i *) (str + plen - 1));
+
+    s1 = _mm_or_si128(s1, firstOr_);
+    s2 = _mm_or_si128(s2, lastOr_);
+
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(s1, first_), _mm_cmpeq_epi8(s2, last_));
+
+    return uint(_mm_movemask_epi8(eq));
+  }
+
+ private:
+  __m128i first_, last_, firstOr_, lastOr_;
+};
+#endif
+
+#ifdef __AVX2__
+class AVX2Block {
+ public:
+  static const uint width = 32;
+
+  AVX2Block(const char *pattern, uint plen, bool caseSensitive) {
+    char c1 = pattern[0], c2 = pattern[plen - 1];
+
+    if (! caseSensitive) {
+      c1 = lowerChar(c1);
+      c2 = lowerChar(c2);
+    }
+
+    first_   = _mm256_set1_epi8(c1);
+    last_    = _mm256_set1_epi8(c2);
+    firstOr_ = _mm256_set1_epi8(caseMask(c1, caseSensitive));
+    lastOr_  = _mm256_set1_epi8(caseMask(c2, caseSensitive));
+  }
+
+  // bit mask of positions in block whose first and last chars match
+  uint mask(const char *str, uint plen) const {
+    __m256i s1 = _mm256_loadu_si256((const __m256i *) str);
+    __m256i s2 = _mm256_loadu_si256((const __m256i *) (str + plen - 1));
+
+    s1 = _mm256_or_si256(s1, firstOr_);
+    s2 = _mm256_or_si256(s2, lastOr_);
+
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(s1, first_), _mm256_cmpeq_epi8(s2, last_));
+
+    return uint(_mm256_movemask_epi8(eq));
+  }
+
+ private:
+  __m256i first_, last_, firstOr_, lastOr_;
+};
+#endif
+
+#if defined(__SSE2__) || defined(__AVX2__)
+template<typename BLOCK>
+int blockFindNext(const char *str, uint len, const char *pattern, uint plen, bool caseSensitive)
+{
+  BLOCK block(pattern, plen, caseSensitive);
+
+  uint i = 0;
+
+  // block loads read chars [i, i + width + plen - 1)
+  for ( ; i + BLOCK::width + plen - 1 <= len; i += BLOCK::width) {
+    uint mask = block.mask(str + i, plen);
+
+    while (mask) {
+      uint bit = uint(__builtin_ctz(mask));
+
+      if (equalChars(str + i + bit, pattern, plen, caseSensitive))
+        return int(i + bit);
+
+      mask &= mask - 1;
+    }
+  }
+
+  return scalarFindNext(str, len, pattern, plen, caseSensitive, i);
+}
+
+template<typename BLOCK>
+int blockFindPrev(const char *str, uint len, const char *pattern, uint plen, bool caseSensitive)
+{
+  BLOCK block(pattern, plen, caseSensitive);
+
+  int i = int(len - plen) + 1 - int(BLOCK::width);
+
+  for ( ; i >= 0; i -= BLOCK::width) {
+    uint mask = block.mask(str + i, plen);
+
+    while (mask) {
+      uint bit = 31 - uint(__builtin_clz(mask));
+
+      if (equalChars(str + i + bit, pattern, plen, caseSensitive))
+        return int(i + bit);
+
+      mask &= ~(1U << bit);
+    }
+  }
+
+  return scalarFindPrev(str, pattern, plen, caseSensitive, i + int(BLOCK::width) - 1);
+}
+#endif
+
+}
+
+//------
+
+namespace CTextFileStrSearch {
+
+int
+findNext(const char *str, uint len, const char *pattern, uint plen, bool caseSensitive)
+{
+  if (plen == 0 || plen > len)
+    return -1;
+
+#if defined(__AVX2__)
+  return blockFindNext<AVX2Block>(str, len, pattern, plen, caseSensitive);
+#elif defined(__SSE2__)
+  return blockFindNext<SSE2Block>(str, len, pattern, plen, caseSensitive);
+#else
+  return scalarFindNext(str, len, pattern, plen, caseSensitive, 0);
+#endif
+}
+
+int
+findPrev(const char *str, uint len, const char *pattern, uint plen, bool caseSensitive)
+{
+  if (plen == 0 || plen > len)
+    return -1;
+
+#if defined(__AVX2__)
+  return blockFindPrev<AVX2Block>(str, len, pattern, plen, caseSensitive);
+#elif defined(__SSE2__)
+  return blockFindPrev<SSE2Block>(str, len, pattern, plen, caseSensitive);
+#else
+  return scalarFindPrev(str, pattern, plen, caseSensitive, int(len - plen));
+#endif
+}
+
+}
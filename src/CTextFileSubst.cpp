@@ -0,0 +1,205 @@
+#include <CTextFileSubst.h>
+#include <CTextFileLineRegExp.h>
+#include <cctype>
+
+CTextFileSubst::
+CTextFileSubst(const std::string &find, const std::string &replace,
+               bool global, bool caseSensitive) :
+ find_(find), replace_(replace), global_(global), caseSensitive_(caseSensitive)
+{
+  regexp_ = std::make_unique<CTextFileLineRegExp>(find_, caseSensitive_);
+
+  parseReplace();
+}
+
+CTextFileSubst::
+CTextFileSubst(const CTextFileSubst &subst) :
+ find_(subst.find_), replace_(subst.replace_), global_(subst.global_),
+ caseSensitive_(subst.caseSensitive_), parts_(subst.parts_)
+{
+  regexp_ = std::make_unique<CTextFileLineRegExp>(*subst.regexp_);
+}
+
+CTextFileSubst::
+~CTextFileSubst()
+{
+}
+
+uint
+CTextFileSubst::
+substLine(const std::string &line, std::string &newLine)
+{
+  newLine.clear();
+
+  uint len = uint(line.size());
+
+  uint pos     = 0; // start of next match
+  uint copyPos = 0; // end of line chars copied to new line
+
+  uint n = 0;
+
+  // each match is found in place from its start position in the whole line
+  while (regexp_->find(line, pos)) {
+    int spos, epos;
+
+    if (! regexp_->getMatchRange(&spos, &epos))
+      break;
+
+    uint spos1 = uint(spos);
+    uint epos1 = (epos >= spos ? uint(epos) + 1 : spos1); // exclusive
+
+    newLine.append(line, copyPos, spos1 - copyPos);
+
+    addReplace(line, spos, epos, newLine);
+
+    copyPos = epos1;
+
+    ++n;
+
+    if (! global_)
+      break;
+
+    // continue after match (after next char for empty match). An empty match at
+    // the end of the line is only allowed if the previous match was also empty
+    pos = (epos1 > spos1 ? epos1 : spos1 + 1);
+
+    if (pos > len || (pos == len && epos1 > spos1))
+      break;
+  }
+
+  if (n == 0)
+    return 0;
+
+  newLine.append(line, copyPos, std::string::npos);
+
+  return n;
+}
+
+void
+CTextFileSubst::
+parseReplace()
+{
+  parts_.clear();
+
+  Part part;
+
+  auto flushText = [&]() {
+    if (! part.text.empty()) {
+      parts_.push_back(part);
+
+      part.text.clear();
+    }
+  };
+
+  auto addRef = [&](int ref) {
+    flushText();
+
+    Part refPart;
+
+    refPart.ref = ref;
+
+    parts_.push_back(refPart);
+  };
+
+  auto addCaseOp = [&](CaseOp caseOp) {
+    flushText();
+
+    Part casePart;
+
+    casePart.caseOp = caseOp;
+
+    parts_.push_back(casePart);
+  };
+
+  uint len = uint(replace_.size());
+
+  for (uint i = 0; i < len; ++i) {
+    char c = replace_[i];
+
+    if      (c == '&')
+      addRef(0);
+    else if (c == '\\' && i + 1 < len) {
+      char c1 = replace_[++i];
+
+      if      (isdigit((unsigned char) c1))
+        addRef(c1 - '0');
+      else if (c1 == 'n' || c1 == 'r')
+        part.text += '\n'; // line break
+      else if (c1 == 't')
+        part.text += '\t';
+      else if (c1 == 'u')
+        addCaseOp(CaseOp::UPPER_NEXT);
+      else if (c1 == 'l')
+        addCaseOp(CaseOp::LOWER_NEXT);
+      else if (c1 == 'U')
+        addCaseOp(CaseOp::UPPER);
+      else if (c1 == 'L')
+        addCaseOp(CaseOp::LOWER);
+      else if (c1 == 'e' || c1 == 'E')
+        addCaseOp(CaseOp::END);
+      else
+        part.text += c1; // \& or \\ (escaped char)
+    }
+    else
+      part.text += c;
+  }
+
+  flushText();
+}
+
+void
+CTextFileSubst::
+addReplace(const std::string &line, int spos, int epos, std::string &newLine) const
+{
+  CaseOp caseOp = CaseOp::NONE; // \U or \L
+  CaseOp nextOp = CaseOp::NONE; // \u or \l
+
+  auto addText = [&](const std::string &text, uint pos, uint n) {
+    if (n == 0)
+      return;
+
+    uint i1 = uint(newLine.size());
+
+    newLine.append(text, pos, n);
+
+    if (caseOp == CaseOp::NONE && nextOp == CaseOp::NONE)
+      return;
+
+    uint i2 = uint(newLine.size());
+
+    for (uint i = i1; i < i2; ++i) {
+      unsigned char c = (unsigned char) newLine[i];
+
+      if      (caseOp == CaseOp::UPPER) c = (unsigned char) toupper(c);
+      else if (caseOp == CaseOp::LOWER) c = (unsigned char) tolower(c);
+
+      newLine[i] = char(c);
+    }
+
+    if      (nextOp == CaseOp::UPPER_NEXT)
+      newLine[i1] = char(toupper((unsigned char) newLine[i1]));
+    else if (nextOp == CaseOp::LOWER_NEXT)
+      newLine[i1] = char(tolower((unsigned char) newLine[i1]));
+
+    nextOp = CaseOp::NONE;
+  };
+
+  for (const auto &part : parts_) {
+    if      (part.caseOp == CaseOp::UPPER_NEXT || part.caseOp == CaseOp::LOWER_NEXT)
+      nextOp = part.caseOp;
+    else if (part.caseOp == CaseOp::UPPER || part.caseOp == CaseOp::LOWER)
+      caseOp = part.caseOp;
+    else if (part.caseOp == CaseOp::END)
+      caseOp = CaseOp::NONE;
+    else if (part.ref < 0)
+      addText(part.text, 0, uint(part.text.size()));
+    else {
+      int spos1 = spos, epos1 = epos;
+
+      if (part.ref == 0 || regexp_->getSubMatchRange(part.ref - 1, &spos1, &epos1)) {
+        if (epos1 >= spos1)
+          addText(line, uint(spos1), uint(epos1 - spos1 + 1));
+      }
+    }
+  }
+}
@@ -0,0 +1,909 @@
+#include <CTextFileTrigramIndex.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+// edits larger than this rebuild the index in the background
+const uint s_maxEditLines = 65536;
+
+// edits logged while building before the build is redone
+const uint s_maxBuildEdits = 4096;
+
+// lines per block (blocks are split when twice this and merged when below a quarter)
+const uint s_blockLines = 64;
+
+// bloom filter bits per distinct trigram and number of hashes
+const uint s_bitsPerTrigram = 10;
+const uint s_numHashes      = 3;
+
+inline uint32_t trigramValue(uint c1, uint c2, uint c3)
+{
+  return uint32_t((c1 << 16) | (c2 << 8) | c3);
+}
+
+}
+
+//------
+
+CTextFileTrigramIndex::Scan::
+Scan(const CTextFileTrigramIndex *index, const CTextFileTrigramSig *sig, bool forward) :
+ index_(index), sig_(sig), forward_(forward)
+{
+}
+
+int
+CTextFileTrigramIndex::Scan::
+nextLine(int line_num)
+{
+  if (! index_ || ! sig_ || line_num < 0)
+    return line_num;
+
+  // still in last matching block
+  if (line_num >= start_ && line_num <= end_)
+    return line_num;
+
+  uint start, end;
+
+  if (! index_->findBlock(uint(line_num), *sig_, forward_, &start, &end))
+    return -1;
+
+  start_ = int(start);
+  end_   = int(end);
+
+  return (forward_ ? std::max(line_num, start_) : std::min(line_num, end_));
+}
+
+//------
+
+CTextFileTrigramIndex::
+CTextFileTrigramIndex(CTextFile *file) :
+ file_(file)
+{
+  file_->addNotifier(this);
+
+  file_->setSearchIndex(this);
+
+  rebuild();
+}
+
+CTextFileTrigramIndex::
+~CTextFileTrigramIndex()
+{
+  cancelBuild();
+
+  if (file_->getSearchIndex() == this)
+    file_->setSearchIndex(nullptr);
+
+  file_->removeNotifier(this);
+}
+
+bool
+CTextFileTrigramIndex::
+isValid()
+{
+  if (state_ == State::BUILDING && buildDone_) {
+    buildThread_.join();
+
+    // too many edits made while building so rebuild
+    if (buildStale_) {
+      rebuild();
+
+      return false;
+    }
+
+    blocks_ = std::move(buildBlocks_);
+
+    buildBlocks_.clear();
+
+    numLines_ = 0;
+
+    for (const auto &block : blocks_)
+      numLines_ += block.numLines;
+
+    resizeBlocks();
+
+    state_ = State::VALID;
+
+    // replay edits made while building (edited blocks are rebuilt from the file below)
+    for (const auto &edit : buildEdits_) {
+      if (! applyEdit(edit)) {
+        state_ = State::INVALID;
+        break;
+      }
+    }
+
+    buildEdits_.clear();
+
+    if (state_ == State::INVALID) {
+      invalidate();
+
+      rebuild();
+
+      return false;
+    }
+  }
+
+  if (state_ == State::VALID && dirty_)
+    updateBlocks();
+
+  return (state_ == State::VALID);
+}
+
+bool
+CTextFileTrigramIndex::
+findBlock(uint line_num, const CTextFileTrigramSig &sig, bool forward,
+          uint *start, uint *end) const
+{
+  uint n = numLines_;
+
+  // no index so all lines may match
+  if (state_ != State::VALID || sig.isEmpty()) {
+    *start = (forward ? line_num : 0);
+    *end   = (forward ? std::max(n, line_num + 1) - 1 : line_num);
+
+    return true;
+  }
+
+  if (line_num >= n) {
+    if (forward || n == 0)
+      return false;
+
+    line_num = n - 1;
+  }
+
+  uint start1;
+
+  int i = int(lineBlock(line_num, &start1));
+
+  int numBlocks = int(blocks_.size());
+
+  while (i >= 0 && i < numBlocks) {
+    const Block &block = blocks_[uint(i)];
+
+    if (blockCanMatch(block, sig)) {
+      *start = start1;
+      *end   = start1 + block.numLines - 1;
+
+      return true;
+    }
+
+    if (forward) {
+      start1 += block.numLines;
+
+      ++i;
+    }
+    else {
+      --i;
+
+      if (i >= 0)
+        start1 -= blocks_[uint(i)].numLines;
+    }
+  }
+
+  return false;
+}
+
+void
+CTextFileTrigramIndex::
+skipStats(const CTextFileTrigramSig &sig, double *blocks, double *lines) const
+{
+  uint numBlocks = 0, numLines = 0, skipBlocks = 0, skipLines = 0;
+
+  for (const auto &block : blocks_) {
+    ++numBlocks;
+
+    numLines += block.numLines;
+
+    if (! blockCanMatch(block, sig)) {
+      ++skipBlocks;
+
+      skipLines += block.numLines;
+    }
+  }
+
+  *blocks = (numBlocks > 0 ? double(skipBlocks)/numBlocks : 0.0);
+  *lines  = (numLines  > 0 ? double(skipLines )/numLines  : 0.0);
+}
+
+void
+CTextFileTrigramIndex::
+addTrigrams(const std::string &str, Trigrams &trigrams)
+{
+  uint len = uint(str.size());
+
+  if (len < 3)
+    return;
+
+  uint c1 = uint(tolower((unsigned char) str[0]));
+  uint c2 = uint(tolower((unsigned char) str[1]));
+
+  for (uint i = 2; i < len; ++i) {
+    uint c3 = uint(tolower((unsigned char) str[i]));
+
+    trigrams.push_back(trigramValue(c1, c2, c3));
+
+    c1 = c2;
+    c2 = c3;
+  }
+}
+
+uint64_t
+CTextFileTrigramIndex::
+trigramHash(uint32_t trigram)
+{
+  // splitmix64 finalizer
+  uint64_t h = trigram + 0x9E3779B97F4A7C15ULL;
+
+  h = (h ^ (h >> 30))*0xBF58476D1CE4E5B9ULL;
+  h = (h ^ (h >> 27))*0x94D049BB133111EBULL;
+
+  return h ^ (h >> 31);
+}
+
+void
+CTextFileTrigramIndex::
+buildBlock(Block &block, const CTextLineList &lines, uint i1, BlockData &data)
+{
+  Trigrams &trigrams = data.trigrams;
+
+  trigrams.clear();
+
+  for (uint i = 0; i < block.numLines; ++i)
+    addTrigrams(lines[i1 + i]->getString(), trigrams);
+
+  // remove duplicates (bit per trigram value)
+  if (data.seen.empty())
+    data.seen.resize((1 << 24)/64);
+
+  uint n = 0;
+
+  for (const auto &trigram : trigrams) {
+    uint64_t &word = data.seen[trigram >> 6];
+    uint64_t  bit  = uint64_t(1) << (trigram & 63);
+
+    if (! (word & bit)) {
+      word |= bit;
+
+      trigrams[n++] = trigram;
+    }
+  }
+
+  trigrams.resize(n);
+
+  for (const auto &trigram : trigrams)
+    data.seen[trigram >> 6] = 0;
+
+  // size filter to distinct trigrams (power of 2 words)
+  uint numWords = 1;
+
+  while (numWords*64 < trigrams.size()*s_bitsPerTrigram)
+    numWords *= 2;
+
+  block.bits.assign(numWords, 0);
+
+  uint64_t mask = uint64_t(numWords)*64 - 1;
+
+  for (const auto &trigram : trigrams) {
+    uint64_t h = trigramHash(trigram);
+
+    // double hashing for bit positions
+    uint64_t h1 = h & 0xffffffff;
+    uint64_t h2 = (h >> 32) | 1;
+
+    for (uint k = 0; k < s_numHashes; ++k) {
+      uint64_t bit = (h1 + k*h2) & mask;
+
+      block.bits[bit >> 6] |= (uint64_t(1) << (bit & 63));
+    }
+  }
+
+  block.dirty = false;
+}
+
+bool
+CTextFileTrigramIndex::
+blockCanMatch(const Block &block, const CTextFileTrigramSig &sig)
+{
+  if (block.dirty)
+    return true;
+
+  uint64_t mask = uint64_t(block.bits.size())*64 - 1;
+
+  for (const auto &h : sig.hashes) {
+    uint64_t h1 = h & 0xffffffff;
+    uint64_t h2 = (h >> 32) | 1;
+
+    for (uint k = 0; k < s_numHashes; ++k) {
+      uint64_t bit = (h1 + k*h2) & mask;
+
+      if (! (block.bits[bit >> 6] & (uint64_t(1) << (bit & 63))))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+bool
+CTextFileTrigramIndex::
+literalSignature(const std::string &str, CTextFileTrigramSig &sig)
+{
+  Trigrams trigrams;
+
+  addTrigrams(str, trigrams);
+
+  setSignature(trigrams, sig);
+
+  return ! sig.isEmpty();
+}
+
+bool
+CTextFileTrigramIndex::
+regexpSignature(const std::string &pattern, CTextFileTrigramSig &sig)
+{
+  // collect runs of literal chars which must be in any match. Anything inside a
+  // group is ignored, and a quantifier removes the char before it from the run
+  sig = CTextFileTrigramSig();
+
+  Trigrams trigrams;
+
+  std::string run;
+
+  auto flushRun = [&]() {
+    addTrigrams(run, trigrams);
+
+    run.clear();
+  };
+
+  auto skipTo = [&](uint &i, char c) {
+    while (i < pattern.size() && pattern[i] != c)
+      ++i;
+
+    if (i < pattern.size())
+      ++i;
+  };
+
+  uint len = uint(pattern.size());
+
+  int depth = 0;
+
+  uint i = 0;
+
+  while (i < len) {
+    char c = pattern[i++];
+
+    if (c == '\\') {
+      if (i >= len)
+        break;
+
+      char c1 = pattern[i++];
+
+      if      (c1 == '|') {
+        if (depth == 0)
+          return false;
+
+        continue;
+      }
+      else if (c1 == '(') {
+        flushRun();
+
+        ++depth;
+
+        continue;
+      }
+      else if (c1 == ')') {
+        flushRun();
+
+        if (depth > 0)
+          --depth;
+
+        continue;
+      }
+      else if (c1 == '{') {
+        if (! run.empty())
+          run.pop_back();
+
+        flushRun();
+
+        skipTo(i, '}');
+
+        continue;
+      }
+      // optional (GNU/vim extension) so the char before is not required
+      else if (c1 == '?' || c1 == '=') {
+        if (! run.empty())
+          run.pop_back();
+
+        flushRun();
+
+        continue;
+      }
+      // any other escape except a quoted metachar (one or more, class, word boundary,
+      // back reference, ...) ends the run
+      else if (! strchr(".[]*^$\\/", c1)) {
+        flushRun();
+
+        continue;
+      }
+
+      c = c1;
+    }
+    else if (c == '|') {
+      if (depth == 0)
+        return false;
+
+      continue;
+    }
+    else if (c == '(') {
+      flushRun();
+
+      ++depth;
+
+      continue;
+    }
+    else if (c == ')') {
+      flushRun();
+
+      if (depth > 0)
+        --depth;
+
+      continue;
+    }
+    else if (c == '[') {
+      flushRun();
+
+      if (i < len && pattern[i] == '^') ++i;
+      if (i < len && pattern[i] == ']') ++i;
+
+      skipTo(i, ']');
+
+      continue;
+    }
+    else if (c == '*' || c == '?' || c == '{') {
+      if (! run.empty())
+        run.pop_back();
+
+      flushRun();
+
+      if (c == '{')
+        skipTo(i, '}');
+
+      continue;
+    }
+    else if (c == '+' || c == '.' || c == '^' || c == '$') {
+      flushRun();
+
+      continue;
+    }
+
+    if (depth == 0)
+      run += c;
+  }
+
+  flushRun();
+
+  setSignature(trigrams, sig);
+
+  return ! sig.isEmpty();
+}
+
+void
+CTextFileTrigramIndex::
+setSignature(Trigrams &trigrams, CTextFileTrigramSig &sig)
+{
+  std::sort(trigrams.begin(), trigrams.end());
+
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+  sig.hashes.clear();
+
+  for (const auto &trigram : trigrams)
+    sig.hashes.push_back(trigramHash(trigram));
+}
+
+void
+CTextFileTrigramIndex::
+rebuild()
+{
+  cancelBuild();
+
+  buildDone_ = false;
+
+  state_ = State::BUILDING;
+
+  // lines are copied on write so snapshot lines can be read in the build thread
+  CTextFileSnapshot snapshot = file_->getSnapshot();
+
+  buildThread_ = std::thread([this, lines = std::move(snapshot.lines)]() {
+    uint numLines = uint(lines.size());
+
+    Blocks blocks((numLines + s_blockLines - 1)/s_blockLines);
+
+    BlockData data;
+
+    uint i1 = 0;
+
+    for (auto &block : blocks) {
+      if (buildCancel_)
+        return;
+
+      block.numLines = std::min(s_blockLines, numLines - i1);
+
+      buildBlock(block, lines, i1, data);
+
+      i1 += block.numLines;
+    }
+
+    buildBlocks_ = std::move(blocks);
+
+    buildDone_ = true;
+  });
+}
+
+void
+CTextFileTrigramIndex::
+fileOpened(const std::string &)
+{
+  invalidate();
+
+  if (noUndoDepth_ == 0)
+    rebuild();
+}
+
+void
+CTextFileTrigramIndex::
+lineAdded(const std::string &, uint line_num)
+{
+  addEdit(line_num, 0, 1);
+}
+
+void
+CTextFileTrigramIndex::
+lineDeleted(const std::string &, uint line_num)
+{
+  addEdit(line_num, 1, 0);
+}
+
+void
+CTextFileTrigramIndex::
+lineReplaced(const std::string &, const std::string &, uint line_num)
+{
+  addEdit(line_num, 1, 1);
+}
+
+void
+CTextFileTrigramIndex::
+charAdded(char, uint line_num, uint)
+{
+  addEdit(line_num, 1, 1);
+}
+
+void
+CTextFileTrigramIndex::
+charDeleted(char, uint line_num, uint)
+{
+  addEdit(line_num, 1, 1);
+}
+
+void
+CTextFileTrigramIndex::
+charReplaced(char, char, uint line_num, uint)
+{
+  addEdit(line_num, 1, 1);
+}
+
+void
+CTextFileTrigramIndex::
+linesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  if (state_ == State::INVALID)
+    return;
+
+  if (newLines.size() > s_maxEditLines) {
+    invalidate();
+
+    if (noUndoDepth_ == 0)
+      rebuild();
+
+    return;
+  }
+
+  addEdit(line_num, uint(oldLines.size()), uint(newLines.size()));
+}
+
+void
+CTextFileTrigramIndex::
+startNoUndo()
+{
+  ++noUndoDepth_;
+}
+
+void
+CTextFileTrigramIndex::
+endNoUndo()
+{
+  assert(noUndoDepth_ > 0);
+
+  --noUndoDepth_;
+
+  if (noUndoDepth_ == 0 && state_ == State::INVALID)
+    rebuild();
+}
+
+void
+CTextFileTrigramIndex::
+addEdit(uint line_num, uint n, uint count)
+{
+  // bulk edit (e.g. load) so rebuild at end
+  if (noUndoDepth_ > 0) {
+    invalidate();
+    return;
+  }
+
+  if (state_ == State::INVALID)
+    return;
+
+  // merge finished build so edit is applied directly (a restarted build has the edit)
+  if (state_ == State::BUILDING && buildDone_ && ! isValid())
+    return;
+
+  Edit edit;
+
+  edit.line_num = line_num;
+  edit.n        = n;
+  edit.count    = count;
+
+  if (state_ == State::BUILDING) {
+    // drop log (and rebuild when done) if too many edits
+    if (! buildStale_) {
+      if (buildEdits_.size() < s_maxBuildEdits)
+        buildEdits_.push_back(edit);
+      else {
+        buildEdits_.clear();
+
+        buildStale_ = true;
+      }
+    }
+
+    return;
+  }
+
+  if (! applyEdit(edit)) {
+    invalidate();
+
+    rebuild();
+  }
+}
+
+bool
+CTextFileTrigramIndex::
+applyEdit(const Edit &edit)
+{
+  if (edit.line_num + edit.n > numLines_ || (edit.n == 0 && edit.count == 0))
+    return (edit.line_num + edit.n <= numLines_);
+
+  dirty_ = true;
+
+  if (blocks_.empty()) {
+    blocks_.emplace_back();
+
+    blocks_[0].numLines = edit.count;
+
+    numLines_ = edit.count;
+
+    resizeBlocks();
+
+    return true;
+  }
+
+  // block containing line (last block for append)
+  uint start;
+
+  uint i = lineBlock(std::min(edit.line_num, numLines_ - 1), &start);
+
+  Block &block = blocks_[i];
+
+  block.dirty = true;
+
+  numLines_ = numLines_ - edit.n + edit.count;
+
+  // edit in block so just update its line count (unless it needs resizing)
+  if (edit.line_num + edit.n <= start + block.numLines) {
+    uint numLines1 = block.numLines - edit.n + edit.count;
+
+    if (numLines1 >= s_blockLines/4 && numLines1 <= 2*s_blockLines) {
+      addTreeLines(i, int(numLines1) - int(block.numLines));
+
+      block.numLines = numLines1;
+
+      return true;
+    }
+
+    block.numLines = numLines1;
+  }
+  else {
+    // remove lines from following blocks and add new lines to block
+    uint n = edit.line_num + edit.n - (start + block.numLines);
+
+    block.numLines = edit.line_num - start + edit.count;
+
+    for (uint j = i + 1; n > 0 && j < blocks_.size(); ++j) {
+      Block &block1 = blocks_[j];
+
+      uint n1 = std::min(n, block1.numLines);
+
+      block1.numLines -= n1;
+      block1.dirty     = true;
+
+      n -= n1;
+    }
+  }
+
+  resizeBlocks();
+
+  return true;
+}
+
+void
+CTextFileTrigramIndex::
+resizeBlocks()
+{
+  Blocks blocks;
+
+  blocks.reserve(blocks_.size());
+
+  for (auto &block : blocks_) {
+    if (block.numLines == 0)
+      continue;
+
+    // merge small block into previous block
+    if (! blocks.empty() && (block.numLines < s_blockLines/4 ||
+                             blocks.back().numLines < s_blockLines/4)) {
+      Block &block1 = blocks.back();
+
+      block1.numLines += block.numLines;
+      block1.dirty     = true;
+
+      continue;
+    }
+
+    blocks.push_back(std::move(block));
+  }
+
+  blocks_.clear();
+
+  // split large blocks
+  for (auto &block : blocks) {
+    if (block.numLines <= 2*s_blockLines) {
+      blocks_.push_back(std::move(block));
+
+      continue;
+    }
+
+    // equal sized blocks of at most s_blockLines
+    uint n  = block.numLines;
+    uint nb = (n + s_blockLines - 1)/s_blockLines;
+
+    for (uint j = 0; j < nb; ++j) {
+      Block block1;
+
+      block1.numLines = n/nb + (j < n % nb ? 1 : 0);
+
+      blocks_.push_back(std::move(block1));
+    }
+  }
+
+  dirty_ = true;
+
+  // rebuild tree
+  uint numBlocks = uint(blocks_.size());
+
+  tree_.assign(numBlocks + 1, 0);
+
+  for (uint i = 1; i <= numBlocks; ++i) {
+    tree_[i] += blocks_[i - 1].numLines;
+
+    uint j = i + (i & -i);
+
+    if (j <= numBlocks)
+      tree_[j] += tree_[i];
+  }
+}
+
+void
+CTextFileTrigramIndex::
+addTreeLines(uint i, int d)
+{
+  for (uint j = i + 1; j < tree_.size(); j += (j & -j))
+    tree_[j] += uint(d);
+}
+
+uint
+CTextFileTrigramIndex::
+lineBlock(uint line_num, uint *start) const
+{
+  uint numBlocks = uint(tree_.size()) - 1;
+
+  uint step = 1;
+
+  while (step*2 <= numBlocks)
+    step *= 2;
+
+  // largest prefix of blocks with line count <= line_num
+  uint i = 0;
+  uint n = line_num;
+
+  for ( ; step > 0; step /= 2) {
+    if (i + step <= numBlocks && tree_[i + step] <= n) {
+      i += step;
+
+      n -= tree_[i];
+    }
+  }
+
+  *start = line_num - n;
+
+  return i;
+}
+
+void
+CTextFileTrigramIndex::
+updateBlocks()
+{
+  // index out of step with file
+  if (numLines_ != file_->getNumLines()) {
+    invalidate();
+
+    rebuild();
+
+    return;
+  }
+
+  BlockData data;
+
+  uint start = 0;
+
+  for (auto &block : blocks_) {
+    if (block.dirty)
+      buildBlock(block, file_->getLines(start, block.numLines), 0, data);
+
+    start += block.numLines;
+  }
+
+  dirty_ = false;
+}
+
+void
+CTextFileTrigramIndex::
+invalidate()
+{
+  cancelBuild();
+
+  state_ = State::INVALID;
+
+  blocks_.clear();
+  tree_  .clear();
+
+  numLines_ = 0;
+  dirty_    = false;
+}
+
+void
+CTextFileTrigramIndex::
+cancelBuild()
+{
+  if (buildThread_.joinable()) {
+    buildCancel_ = true;
+
+    buildThread_.join();
+
+    buildCancel_ = false;
+  }
+
+  buildBlocks_.clear();
+  buildEdits_ .clear();
+
+  buildStale_ = false;
+}
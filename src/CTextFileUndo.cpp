@@ -1,5 +1,6 @@
 #include <CTextFileUndo.h>
 #include <CTextFile.h>
+#include <algorithm>
 #include <cstdlib>
 
 CTextFileUndo::
@@ -12,6 +13,8 @@ CTextFileUndo(CTextFile *file) :
     debug_ = true;
 
   file_->addNotifier(this);
+
+  addCheckpoint();
 }
 
 CTextFileUndo::
@@ -25,6 +28,14 @@ CTextFileUndo::
 reset()
 {
   undo_.clear();
+
+  noUndoChanged_ = false;
+
+  checkpoints_.clear();
+
+  restoreTimes_.clear();
+
+  addCheckpoint();
 }
 
 void
@@ -32,6 +43,10 @@ CTextFileUndo::
 undo()
 {
   undo_.undo();
+
+  // only a restore can be undone while restored checkpoints are active
+  if (! restoreTimes_.empty())
+    restoreTimes_.pop_back();
 }
 
 void
@@ -39,6 +54,109 @@ CTextFileUndo::
 redo()
 {
   undo_.redo();
+
+  restoreTimes_.clear();
+}
+
+uint
+CTextFileUndo::
+addCheckpoint()
+{
+  // keep first checkpoint (file as loaded) and drop oldest of the rest
+  if (maxCheckpoints_ > 1 && checkpoints_.size() >= maxCheckpoints_)
+    checkpoints_.erase(checkpoints_.begin() + 1);
+
+  Checkpoint checkpoint;
+
+  // line table is rebuilt after unrecorded (no undo) edits
+  if (! linesValid_) {
+    lines_.assign(file_->getSnapshot().lines);
+
+    linesValid_ = true;
+  }
+
+  checkpoint.time   = time(NULL);
+  checkpoint.chunks = lines_.getChunks();
+
+  file_->getPos(&checkpoint.x, &checkpoint.y);
+
+  checkpoints_.push_back(checkpoint);
+
+  numChanges_ = 0;
+
+  if (debug_)
+    std::cerr << "Add: Checkpoint " << checkpoints_.size() - 1 << std::endl;
+
+  return uint(checkpoints_.size() - 1);
+}
+
+bool
+CTextFileUndo::
+restoreCheckpoint(uint i)
+{
+  if (i >= checkpoints_.size())
+    return false;
+
+  if (debug_)
+    std::cerr << "Exec: Restore Checkpoint " << i << std::endl;
+
+  // restore is recorded as a single splice so it can be undone
+  restoring_ = true;
+
+  const Checkpoint &checkpoint = checkpoints_[i];
+
+  CTextFileSnapshot snapshot;
+
+  snapshot.lines = CTextFileLineTable::toLines(checkpoint.chunks);
+  snapshot.x     = checkpoint.x;
+  snapshot.y     = checkpoint.y;
+
+  file_->restoreSnapshot(snapshot);
+
+  restoring_ = false;
+
+  restoreTimes_.push_back(checkpoints_[i].time);
+
+  return true;
+}
+
+bool
+CTextFileUndo::
+restoreEarlier(uint secs)
+{
+  if (checkpoints_.empty())
+    return false;
+
+  time_t t = (! restoreTimes_.empty() ? restoreTimes_.back() : time(NULL));
+
+  // find newest checkpoint at least secs older than current state (oldest if none)
+  uint n = uint(checkpoints_.size());
+
+  uint i = 0;
+
+  for (uint j = 1; j < n; ++j) {
+    if (checkpoints_[j].time > t - time_t(secs))
+      break;
+
+    i = j;
+  }
+
+  if (! restoreTimes_.empty() && checkpoints_[i].time == restoreTimes_.back())
+    return false;
+
+  return restoreCheckpoint(i);
+}
+
+bool
+CTextFileUndo::
+restoreLater()
+{
+  if (restoreTimes_.empty())
+    return false;
+
+  undo();
+
+  return true;
 }
 
 //----
@@ -54,6 +172,10 @@ void
 CTextFileUndo::
 lineAdded(const std::string &line, uint line_num)
 {
+  updateLines(line_num, 0, file_->getLines(line_num, 1));
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoDeleteLineCmd(this, line_num, line));
 }
 
@@ -61,6 +183,10 @@ void
 CTextFileUndo::
 lineDeleted(const std::string &line, uint line_num)
 {
+  updateLines(line_num, 1, CTextLineList());
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoAddLineCmd(this, line_num, line));
 }
 
@@ -68,6 +194,10 @@ void
 CTextFileUndo::
 lineReplaced(const std::string &line1, const std::string &line2, uint line_num)
 {
+  updateLine(line_num);
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoReplaceLineCmd(this, line_num, line1, line2));
 }
 
@@ -75,6 +205,10 @@ void
 CTextFileUndo::
 charAdded(char c, uint line_num, uint char_num)
 {
+  updateLine(line_num);
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoDeleteCharCmd(this, line_num, char_num, c));
 }
 
@@ -82,6 +216,10 @@ void
 CTextFileUndo::
 charDeleted(char c, uint line_num, uint char_num)
 {
+  updateLine(line_num);
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoAddCharCmd(this, line_num, char_num, c));
 }
 
@@ -89,14 +227,34 @@ void
 CTextFileUndo::
 charReplaced(char c1, char c2, uint line_num, uint char_num)
 {
+  updateLine(line_num);
+
+  if (! canAddUndo()) return;
+
   addUndo(new CTextFileUndoReplaceCharCmd(this, line_num, char_num, c1, c2));
 }
 
+void
+CTextFileUndo::
+linesSpliced(uint line_num, const CTextLineList &oldLines, const CTextLineList &newLines)
+{
+  updateLines(line_num, uint(oldLines.size()), newLines);
+
+  if (! canAddUndo()) return;
+
+  addUndo(new CTextFileUndoSpliceLinesCmd(this, line_num, oldLines, newLines));
+}
+
 void
 CTextFileUndo::
 startGroup()
 {
   undo_.startGroup();
+
+  if (groupDepth_ == 0)
+    groupChanged_ = false;
+
+  ++groupDepth_;
 }
 
 void
@@ -104,18 +262,290 @@ CTextFileUndo::
 endGroup()
 {
   undo_.endGroup();
+
+  if (groupDepth_ > 0)
+    --groupDepth_;
+
+  if (groupDepth_ == 0 && groupChanged_)
+    changeDone();
+}
+
+void
+CTextFileUndo::
+startNoUndo()
+{
+  if (noUndoDepth_ == 0)
+    noUndoChanged_ = false;
+
+  ++noUndoDepth_;
+}
+
+void
+CTextFileUndo::
+endNoUndo()
+{
+  if (noUndoDepth_ == 0)
+    return;
+
+  --noUndoDepth_;
+
+  // unrecorded edits invalidate existing undo history
+  if (noUndoDepth_ == 0 && noUndoChanged_)
+    reset();
+}
+
+bool
+CTextFileUndo::
+isRecording() const
+{
+  return (noUndoDepth_ == 0 && ! undo_.locked());
+}
+
+bool
+CTextFileUndo::
+canAddUndo()
+{
+  // skip allocation of undo command if it would not be recorded
+  if (noUndoDepth_ > 0) {
+    noUndoChanged_ = true;
+
+    return false;
+  }
+
+  return ! undo_.locked();
 }
 
 void
 CTextFileUndo::
 addUndo(CTextFileUndoCmd *cmd)
 {
-  if (! undo_.locked())
+  if (! undo_.locked()) {
     undo_.addUndo(cmd);
+
+    if (groupDepth_ > 0)
+      groupChanged_ = true;
+    else
+      changeDone();
+  }
   else
     delete cmd;
 }
 
+void
+CTextFileUndo::
+changeDone()
+{
+  if (restoring_)
+    return;
+
+  restoreTimes_.clear();
+
+  if (checkpointInterval_ > 0 && ++numChanges_ >= checkpointInterval_)
+    addCheckpoint();
+}
+
+void
+CTextFileUndo::
+updateLines(uint line_num, uint n, const CTextLineList &lines)
+{
+  if (! linesValid_)
+    return;
+
+  if (noUndoDepth_ > 0) {
+    lines_.clear();
+
+    linesValid_ = false;
+
+    return;
+  }
+
+  lines_.splice(line_num, n, lines);
+}
+
+void
+CTextFileUndo::
+updateLine(uint line_num)
+{
+  if (! linesValid_)
+    return;
+
+  if (noUndoDepth_ > 0) {
+    lines_.clear();
+
+    linesValid_ = false;
+
+    return;
+  }
+
+  // changed line is a copy of line shared with table
+  CTextLineList lines = file_->getLines(line_num, 1);
+
+  if (! lines.empty())
+    lines_.setLine(line_num, lines[0]);
+}
+
+//------
+
+void
+CTextFileLineTable::
+assign(const CTextLineList &lines)
+{
+  clear();
+
+  splice(0, 0, lines);
+}
+
+void
+CTextFileLineTable::
+clear()
+{
+  chunks_.clear();
+  starts_.clear();
+
+  numLines_ = 0;
+}
+
+void
+CTextFileLineTable::
+splice(uint line_num, uint n, const CTextLineList &lines)
+{
+  if (line_num > numLines_)
+    return;
+
+  n = std::min(n, numLines_ - line_num);
+
+  if (n == 0 && lines.empty())
+    return;
+
+  uint numChunks = uint(chunks_.size());
+
+  // edit chunk in place if not shared with a checkpoint and it stays in size (small
+  // chunks are merged with their neighbour below)
+  uint i1 = (numChunks > 0 ? std::min(findChunk(line_num), numChunks - 1) : 0);
+
+  if (numChunks > 0) {
+    CTextLineList &chunk = *chunks_[i1];
+
+    uint pos  = line_num - starts_[i1];
+    uint size = uint(chunk.size()) - n + uint(lines.size());
+
+    if (chunks_[i1].use_count() == 1 && pos + n <= chunk.size() &&
+        (size >= s_maxChunkSize/4 || numChunks == 1) && size > 0 &&
+        size <= s_maxChunkSize) {
+      chunk.erase (chunk.begin() + pos, chunk.begin() + pos + n);
+      chunk.insert(chunk.begin() + pos, lines.begin(), lines.end());
+
+      numLines_ = numLines_ - n + uint(lines.size());
+
+      updateStarts(i1 + 1);
+
+      return;
+    }
+  }
+
+  //---
+
+  // replace edited chunks (and small neighbour) by new chunks
+  uint i2 = (line_num + n < numLines_ ? findChunk(line_num + n) + 1 : numChunks);
+
+  uint start = (i1 < numChunks ? starts_[i1] : 0);
+  uint end   = (i2 < numChunks ? starts_[i2] : numLines_);
+
+  if (i2 < numChunks && end - start - n + lines.size() < s_maxChunkSize/2) {
+    ++i2;
+
+    end = (i2 < numChunks ? starts_[i2] : numLines_);
+  }
+
+  CTextLineList lines1;
+
+  lines1.reserve(end - start - n + lines.size());
+
+  for (uint i = i1; i < i2; ++i)
+    lines1.insert(lines1.end(), chunks_[i]->begin(), chunks_[i]->end());
+
+  lines1.erase (lines1.begin() + (line_num - start),
+                lines1.begin() + (line_num - start + n));
+  lines1.insert(lines1.begin() + (line_num - start), lines.begin(), lines.end());
+
+  // split into equal chunks no larger than max size
+  uint numLines1  = uint(lines1.size());
+  uint numChunks1 = (numLines1 + s_maxChunkSize - 1)/s_maxChunkSize;
+
+  Chunks chunks1;
+
+  for (uint i = 0; i < numChunks1; ++i) {
+    uint j1 = uint(uint64_t(numLines1)* i     /numChunks1);
+    uint j2 = uint(uint64_t(numLines1)*(i + 1)/numChunks1);
+
+    chunks1.push_back(std::make_shared<CTextLineList>(lines1.begin() + j1, lines1.begin() + j2));
+  }
+
+  chunks_.erase (chunks_.begin() + i1, chunks_.begin() + i2);
+  chunks_.insert(chunks_.begin() + i1, chunks1.begin(), chunks1.end());
+
+  numLines_ = numLines_ - n + uint(lines.size());
+
+  starts_.resize(chunks_.size());
+
+  updateStarts(i1);
+}
+
+void
+CTextFileLineTable::
+setLine(uint line_num, const CTextLineP &line)
+{
+  if (line_num >= numLines_)
+    return;
+
+  uint i = findChunk(line_num);
+
+  // copy chunk shared with a checkpoint
+  if (chunks_[i].use_count() > 1)
+    chunks_[i] = std::make_shared<CTextLineList>(*chunks_[i]);
+
+  (*chunks_[i])[line_num - starts_[i]] = line;
+}
+
+CTextLineList
+CTextFileLineTable::
+toLines(const Chunks &chunks)
+{
+  CTextLineList lines;
+
+  for (const auto &chunk : chunks)
+    lines.insert(lines.end(), chunk->begin(), chunk->end());
+
+  return lines;
+}
+
+uint
+CTextFileLineTable::
+findChunk(uint line_num) const
+{
+  Starts::const_iterator p = std::upper_bound(starts_.begin(), starts_.end(), line_num);
+
+  if (p == starts_.begin())
+    return 0;
+
+  return uint(p - starts_.begin()) - 1;
+}
+
+void
+CTextFileLineTable::
+updateStarts(uint i)
+{
+  uint numChunks = uint(chunks_.size());
+
+  uint start = (i > 0 ? starts_[i - 1] + uint(chunks_[i - 1]->size()) : 0);
+
+  for ( ; i < numChunks; ++i) {
+    starts_[i] = start;
+
+    start += uint(chunks_[i]->size());
+  }
+}
+
 //------
 
 CTextFileUndoAddLineCmd::
@@ -346,6 +776,44 @@ exec()
 
 //------
 
+CTextFileUndoSpliceLinesCmd::
+CTextFileUndoSpliceLinesCmd(CTextFileUndo *undo, uint line_num, const CTextLineList &oldLines,
+                            const CTextLineList &newLines) :
+ CTextFileUndoCmd(undo), oldLines_(oldLines), newLines_(newLines)
+{
+  line_num_ = line_num;
+
+  if (undo_->getDebug())
+    std::cerr << "Add: Splice Lines " << line_num << " " << oldLines_.size() <<
+                 " " << newLines_.size() << std::endl;
+}
+
+bool
+CTextFileUndoSpliceLinesCmd::
+exec()
+{
+  if (getState() == UNDO_STATE) {
+    if (undo_->getDebug())
+      std::cerr << "Exec: Splice Lines " << line_num_ << " " << newLines_.size() <<
+                   " " << oldLines_.size() << std::endl;
+
+    undo_->getFile()->spliceLines(line_num_, uint(newLines_.size()), oldLines_);
+  }
+  else {
+    if (undo_->getDebug())
+      std::cerr << "Exec: Splice Lines " << line_num_ << " " << oldLines_.size() <<
+                   " " << newLines_.size() << std::endl;
+
+    undo_->getFile()->spliceLines(line_num_, uint(oldLines_.size()), newLines_);
+  }
+
+  undo_->getFile()->moveTo(char_num_, line_num_);
+
+  return true;
+}
+
+//------
+
 CTextFileUndoCmd::
 CTextFileUndoCmd(CTextFileUndo *undo) :
  undo_(undo)
@@ -1,8 +1,14 @@
 #include <CTextFileUtil.h>
+#include <CTextFileSearch.h>
+#include <CTextFileStrSearch.h>
+#include <CTextFileTrigramIndex.h>
+#include <CTextFileRegExpCache.h>
 #include <CTextFile.h>
 #include <CRegExp.h>
-#include <CStrUtil.h>
+#include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 
 CTextFileUtil::
 CTextFileUtil(CTextFile *file) :
@@ -1030,27 +1036,47 @@ isSection(const std::string &line, uint, uint *n) const
 bool
 CTextFileUtil::
 findNext(const std::string &pattern, uint line_num1, int char_num1,
-         int line_num2, int char_num2, uint *fline_num, uint *fchar_num)
+         int line_num2, int char_num2, uint *fline_num, uint *fchar_num,
+         bool case_sensitive)
 {
   const std::string &line1 = file_->getLine(line_num1);
 
-  if (lineFindNext(line1, pattern, char_num1, -1, fchar_num)) {
+  if (lineFindNext(line1, pattern, char_num1, -1, fchar_num, case_sensitive)) {
     *fline_num = line_num1;
     return true;
   }
 
-  for (int i = int(line_num1) + 1; i <= line_num2 - 1; ++i) {
-    const std::string &line = file_->getLine(i);
+  CTextFileTrigramSig sig;
 
-    if (lineFindNext(line, pattern, 0, -1, fchar_num)) {
-      *fline_num = i;
+  const CTextFileTrigramIndex *index = getSearchIndex(pattern, false, sig);
+
+  if (CTextFileSearch::isParallel(int(line_num1) + 1, line_num2 - 1)) {
+    CTextFileSearch search(file_, this);
+
+    search.setIndex(index, &sig);
+
+    if (search.findNext(pattern, line_num1 + 1, line_num2 - 1, fline_num, fchar_num,
+                        case_sensitive))
       return true;
+  }
+  else {
+    // skip blocks of lines which can't match
+    CTextFileTrigramIndex::Scan scan(index, &sig);
+
+    for (int i = scan.nextLine(int(line_num1) + 1); i >= 0 && i <= line_num2 - 1;
+         i = scan.nextLine(i + 1)) {
+      const std::string &line = file_->getLine(i);
+
+      if (lineFindNext(line, pattern, 0, -1, fchar_num, case_sensitive)) {
+        *fline_num = i;
+        return true;
+      }
     }
   }
 
   const std::string &line2 = file_->getLine(line_num2);
 
-  if (lineFindNext(line2, pattern, 0, char_num2, fchar_num)) {
+  if (lineFindNext(line2, pattern, 0, char_num2, fchar_num, case_sensitive)) {
     *fline_num = line_num2;
     return true;
   }
@@ -1074,16 +1100,37 @@ findNext(const CRegExp &pattern, uint line_num1, int char_num1,
     return true;
   }
 
-  for (int i = int(line_num1) + 1; i <= line_num2 - 1; ++i) {
-    const std::string &line = file_->getLine(i);
+  CTextFileTrigramSig sig;
+
+  const CTextFileTrigramIndex *index = getSearchIndex(pattern.getPattern(), true, sig);
+
+  if (CTextFileSearch::isParallel(int(line_num1) + 1, line_num2 - 1)) {
+    CTextFileSearch search(file_, this);
+
+    search.setIndex(index, &sig);
 
-    if (lineFindNext(line, pattern, 0, -1, &spos, &epos)) {
-      *fline_num = i;
+    if (search.findNext(pattern, line_num1 + 1, line_num2 - 1, fline_num, &spos, &epos)) {
       *fchar_num = spos;
       if (len) *len = epos - spos + 1;
       return true;
     }
   }
+  else {
+    // skip blocks of lines which can't match
+    CTextFileTrigramIndex::Scan scan(index, &sig);
+
+    for (int i = scan.nextLine(int(line_num1) + 1); i >= 0 && i <= line_num2 - 1;
+         i = scan.nextLine(i + 1)) {
+      const std::string &line = file_->getLine(i);
+
+      if (lineFindNext(line, pattern, 0, -1, &spos, &epos)) {
+        *fline_num = i;
+        *fchar_num = spos;
+        if (len) *len = epos - spos + 1;
+        return true;
+      }
+    }
+  }
 
   const std::string &line2 = file_->getLine(line_num2);
 
@@ -1100,7 +1147,7 @@ findNext(const CRegExp &pattern, uint line_num1, int char_num1,
 bool
 CTextFileUtil::
 lineFindNext(const std::string &line, const std::string &pattern,
-            int char_num1, int char_num2, uint *char_num) const
+             int char_num1, int char_num2, uint *char_num, bool case_sensitive) const
 {
   if (line.empty())
     return false;
@@ -1113,17 +1160,17 @@ lineFindNext(const std::string &line, const std::string &pattern,
   if (char_num2 < 0)
     char_num2 = num_chars - 1;
 
-  const char *cline = line.c_str();
-
-  const char *pattern1 = pattern.c_str();
+  if (char_num2 < char_num1)
+    return false;
 
-  char *p = CStrUtil::strstr(&cline[char_num1], &cline[char_num2], pattern1);
+  int pos = CTextFileStrSearch::findNext(&line[char_num1], uint(char_num2 - char_num1 + 1),
+                                         pattern.c_str(), uint(pattern.size()), case_sensitive);
 
-  if (p == NULL)
+  if (pos < 0)
     return false;
 
   if (char_num)
-    *char_num = uint(p - cline);
+    *char_num = uint(pos + char_num1);
 
   return true;
 }
@@ -1144,18 +1191,34 @@ lineFindNext(const std::string &line, const CRegExp &pattern,
   if (char_num2 < 0)
     char_num2 = num_chars - 1;
 
-  std::string line1 = line.substr(char_num1, char_num2 - char_num1 + 1);
+  int spos1, epos1;
 
-  if (! pattern.find(line1))
+  // match in place against whole line (no copy), miss or match inside range is final
+  if (! pattern.find(line))
     return false;
 
-  int spos1, epos1;
-
   if (! pattern.getMatchRange(&spos1, &epos1))
     return false;
 
-  if (spos) *spos = spos1 + char_num1;
-  if (epos) *epos = epos1 + char_num1;
+  if (spos1 > char_num2)
+    return false;
+
+  if (spos1 < char_num1 || epos1 > char_num2) {
+    // match overlaps range start/end so search sub range
+    std::string line1 = line.substr(char_num1, char_num2 - char_num1 + 1);
+
+    if (! pattern.find(line1))
+      return false;
+
+    if (! pattern.getMatchRange(&spos1, &epos1))
+      return false;
+
+    spos1 += char_num1;
+    epos1 += char_num1;
+  }
+
+  if (spos) *spos = spos1;
+  if (epos) *epos = epos1;
 
   return true;
 }
@@ -1163,27 +1226,47 @@ lineFindNext(const std::string &line, const CRegExp &pattern,
 bool
 CTextFileUtil::
 findPrev(const std::string &pattern, uint line_num1, int char_num1,
-         int line_num2, int char_num2, uint *fline_num, uint *fchar_num)
+         int line_num2, int char_num2, uint *fline_num, uint *fchar_num,
+         bool case_sensitive)
 {
   const std::string &line1 = file_->getLine(line_num1);
 
-  if (lineFindPrev(line1, pattern, char_num1, 0, fchar_num)) {
+  if (lineFindPrev(line1, pattern, char_num1, 0, fchar_num, case_sensitive)) {
     *fline_num = line_num1;
     return true;
   }
 
-  for (int i = line_num1 - 1; i >= line_num2 + 1; --i) {
-    const std::string &line = file_->getLine(i);
+  CTextFileTrigramSig sig;
+
+  const CTextFileTrigramIndex *index = getSearchIndex(pattern, false, sig);
+
+  if (CTextFileSearch::isParallel(line_num2 + 1, int(line_num1) - 1)) {
+    CTextFileSearch search(file_, this);
+
+    search.setIndex(index, &sig);
 
-    if (lineFindPrev(line, pattern, -1, 0, fchar_num)) {
-      *fline_num = i;
+    if (search.findPrev(pattern, line_num2 + 1, line_num1 - 1, fline_num, fchar_num,
+                        case_sensitive))
       return true;
+  }
+  else {
+    // skip blocks of lines which can't match
+    CTextFileTrigramIndex::Scan scan(index, &sig, /*forward*/false);
+
+    for (int i = scan.nextLine(line_num1 - 1); i >= 0 && i >= line_num2 + 1;
+         i = scan.nextLine(i - 1)) {
+      const std::string &line = file_->getLine(i);
+
+      if (lineFindPrev(line, pattern, -1, 0, fchar_num, case_sensitive)) {
+        *fline_num = i;
+        return true;
+      }
     }
   }
 
   const std::string &line2 = file_->getLine(line_num2);
 
-  if (lineFindPrev(line2, pattern, -1, char_num2, fchar_num)) {
+  if (lineFindPrev(line2, pattern, -1, char_num2, fchar_num, case_sensitive)) {
     *fline_num = line_num2;
     return true;
   }
@@ -1207,16 +1290,37 @@ findPrev(const CRegExp &pattern, uint line_num1, int char_num1,
     return true;
   }
 
-  for (int i = line_num1 - 1; i >= line_num2 + 1; --i) {
-    const std::string &line = file_->getLine(i);
+  CTextFileTrigramSig sig;
+
+  const CTextFileTrigramIndex *index = getSearchIndex(pattern.getPattern(), true, sig);
 
-    if (lineFindPrev(line, pattern, -1, 0, &spos, &epos)) {
-      *fline_num = i;
+  if (CTextFileSearch::isParallel(line_num2 + 1, int(line_num1) - 1)) {
+    CTextFileSearch search(file_, this);
+
+    search.setIndex(index, &sig);
+
+    if (search.findPrev(pattern, line_num2 + 1, line_num1 - 1, fline_num, &spos, &epos)) {
       *fchar_num = spos;
       if (len) *len = epos - spos + 1;
       return true;
     }
   }
+  else {
+    // skip blocks of lines which can't match
+    CTextFileTrigramIndex::Scan scan(index, &sig, /*forward*/false);
+
+    for (int i = scan.nextLine(line_num1 - 1); i >= 0 && i >= line_num2 + 1;
+         i = scan.nextLine(i - 1)) {
+      const std::string &line = file_->getLine(i);
+
+      if (lineFindPrev(line, pattern, -1, 0, &spos, &epos)) {
+        *fline_num = i;
+        *fchar_num = spos;
+        if (len) *len = epos - spos + 1;
+        return true;
+      }
+    }
+  }
 
   const std::string &line2 = file_->getLine(line_num2);
 
@@ -1233,7 +1337,7 @@ findPrev(const CRegExp &pattern, uint line_num1, int char_num1,
 bool
 CTextFileUtil::
 lineFindPrev(const std::string &line, const std::string &pattern,
-             int char_num1, int char_num2, uint *char_num) const
+             int char_num1, int char_num2, uint *char_num, bool case_sensitive) const
 {
   if (line.empty())
     return false;
@@ -1246,17 +1350,20 @@ lineFindPrev(const std::string &line, const std::string &pattern,
   if (char_num2 >= int(num_chars))
     return false;
 
-  const char *cline = line.c_str();
+  if (char_num1 < char_num2)
+    return false;
 
-  const char *pattern1 = pattern.c_str();
+  // match must start at or before char_num1
+  uint len = std::min(uint(char_num1) + uint(pattern.size()), num_chars) - uint(char_num2);
 
-  char *p = CStrUtil::strrstr(&cline[char_num1], &cline[char_num2], pattern1);
+  int pos = CTextFileStrSearch::findPrev(&line[char_num2], len,
+                                         pattern.c_str(), uint(pattern.size()), case_sensitive);
 
-  if (p == NULL)
+  if (pos < 0)
     return false;
 
   if (char_num)
-    *char_num = uint(p - cline);
+    *char_num = uint(pos + char_num2);
 
   return true;
 }
@@ -1274,25 +1381,66 @@ lineFindPrev(const std::string &line, const CRegExp &pattern,
   if (char_num1 < 0)
     char_num1 = num_chars - 1;
 
-  if (char_num2 >= int(num_chars))
+  if (char_num2 >= int(num_chars) || char_num1 < char_num2)
     return false;
 
-  std::string line1 = line.substr(char_num2, char_num1 - char_num2 + 1);
+  // iterate non-overlapping matches forward in place on the whole line (so anchors and
+  // word boundaries see the real line) and keep the last one starting in range
+  CTextFileLineRegExpP regexp =
+    CTextFileRegExpCacheInst->getLineRegExp(pattern.getPattern(), pattern.getCaseSensitive());
 
-  if (! pattern.find(line1))
-    return false;
+  int spos1 = -1, epos1 = -1;
 
-  int spos1, epos1;
+  uint pos = uint(std::max(char_num2, 0));
 
-  if (! pattern.getMatchRange(&spos1, &epos1))
+  while (pos <= num_chars && regexp->find(line, pos)) {
+    int spos2, epos2;
+
+    if (! regexp->getMatchRange(&spos2, &epos2) || spos2 > char_num1)
+      break;
+
+    spos1 = spos2;
+    epos1 = epos2;
+
+    // continue after match (after next char for empty match)
+    pos = uint(epos2 >= spos2 ? epos2 + 1 : spos2 + 1);
+  }
+
+  if (spos1 < 0)
     return false;
 
-  if (spos) *spos = spos1 + char_num2;
-  if (epos) *epos = epos1 + char_num2;
+  if (spos) *spos = uint(spos1);
+  if (epos) *epos = uint(epos1);
 
   return true;
 }
 
+bool
+CTextFileUtil::
+isLiteralPattern(const std::string &pattern)
+{
+  // any char which is special in basic or extended syntax
+  return (pattern.find_first_of("\\.[]*^$+?(){}|") == std::string::npos);
+}
+
+CTextFileTrigramIndex *
+CTextFileUtil::
+getSearchIndex(const std::string &pattern, bool regexp, CTextFileTrigramSig &sig) const
+{
+  CTextFileTrigramIndex *index = file_->getSearchIndex();
+
+  if (! index || ! index->isValid())
+    return nullptr;
+
+  bool rc = (regexp ? CTextFileTrigramIndex::regexpSignature (pattern, sig) :
+                      CTextFileTrigramIndex::literalSignature(pattern, sig));
+
+  if (! rc)
+    return nullptr;
+
+  return index;
+}
+
 bool
 CTextFileUtil::
 findNextChar(uint line_num, int char_num, char c, bool multiline)
@@ -1440,8 +1588,9 @@ joinLine(uint line_num)
 
   file_->getPos(&char_num, &line_num1);
 
-  const std::string &line1 = file_->getLine(line_num);
-  const std::string &line2 = file_->getLine(line_num + 1);
+  // copy (lines are deleted and replaced)
+  std::string line1 = file_->getLine(line_num);
+  std::string line2 = file_->getLine(line_num + 1);
 
   file_->moveTo(0, line_num + 1);
 
@@ -1478,7 +1627,8 @@ void
 CTextFileUtil::
 moveLine(uint line_num1, int line_num2)
 {
-  const std::string &line1 = file_->getLine(line_num1);
+  // copy (line is deleted)
+  std::string line1 = file_->getLine(line_num1);
 
   file_->moveTo(0, line_num1);
 
@@ -1500,6 +1650,95 @@ copyLine(uint line_num1, uint line_num2)
   file_->addLineAfter(line1);
 }
 
+void
+CTextFileUtil::
+moveLines(uint line_num1, uint line_num2, int line_num3)
+{
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num2 >= numLines)
+    return;
+
+  if (line_num3 < -1 || line_num3 >= int(numLines))
+    return;
+
+  // destination in (or just before) range is a no-op
+  if (line_num3 >= int(line_num1) - 1 && line_num3 <= int(line_num2))
+    return;
+
+  // rotate range and lines between range and destination, and replace them in one
+  // splice
+  uint line_num4, line_num5, n;
+
+  if (line_num3 < int(line_num1)) {
+    line_num4 = uint(line_num3 + 1);
+    line_num5 = line_num2;
+    n         = line_num1 - line_num4; // lines before range
+  }
+  else {
+    line_num4 = line_num1;
+    line_num5 = uint(line_num3);
+    n         = line_num2 - line_num1 + 1; // range
+  }
+
+  CTextLineList lines = file_->getLines(line_num4, line_num5 - line_num4 + 1);
+
+  std::rotate(lines.begin(), lines.begin() + n, lines.end());
+
+  file_->spliceLines(line_num4, uint(lines.size()), lines);
+}
+
+void
+CTextFileUtil::
+copyLines(uint line_num1, uint line_num2, int line_num3)
+{
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num2 >= numLines)
+    return;
+
+  if (line_num3 < -1 || line_num3 >= int(numLines))
+    return;
+
+  // insert shared lines (copied on write)
+  CTextLineList lines = file_->getLines(line_num1, line_num2 - line_num1 + 1);
+
+  file_->spliceLines(uint(line_num3 + 1), 0, lines);
+}
+
+void
+CTextFileUtil::
+joinLines(uint line_num1, uint line_num2)
+{
+  uint numLines = file_->getNumLines();
+
+  line_num2 = std::min(line_num2, numLines - 1);
+
+  if (line_num1 >= line_num2 || line_num2 >= numLines)
+    return;
+
+  CTextLineList lines = file_->getLines(line_num1, line_num2 - line_num1 + 1);
+
+  // build joined line once (joining a line at a time copies the result each time)
+  size_t len = 0;
+
+  for (const auto &line : lines)
+    len += line->getLength();
+
+  std::string str;
+
+  str.reserve(len);
+
+  for (const auto &line : lines)
+    str += line->getString();
+
+  CTextLineList newLines;
+
+  newLines.push_back(file_->createLine(str));
+
+  file_->spliceLines(line_num1, uint(lines.size()), newLines);
+}
+
 void
 CTextFileUtil::
 replace(uint line_num, uint char_num1, uint char_num2, const std::string &replaceStr)
@@ -1516,6 +1755,207 @@ replace(uint line_num, uint char_num1, uint char_num2, const std::string &replac
   file_->moveTo(char_num1, line_num);
 }
 
+uint
+CTextFileUtil::
+replaceLines(const LineEdits &edits)
+{
+  // unchanged lines between edits closer than this are shared in the splice
+  static const uint s_maxSpliceGap = 32;
+
+  uint numLines = file_->getNumLines();
+  uint numEdits = uint(edits.size());
+
+  // new text has a line for each line break
+  auto addLines = [&](const std::string &str, CTextLineList &lines) {
+    std::string::size_type pos = 0, pos1;
+
+    while ((pos1 = str.find('\n', pos)) != std::string::npos) {
+      lines.push_back(file_->createLine(str.substr(pos, pos1 - pos)));
+
+      pos = pos1 + 1;
+    }
+
+    lines.push_back(file_->createLine(pos > 0 ? str.substr(pos) : str));
+  };
+
+  int  shift    = 0; // lines added by earlier line breaks
+  uint lastLine = 0;
+
+  uint i = 0;
+
+  while (i < numEdits) {
+    uint line_num1 = edits[i].line_num;
+
+    if (line_num1 >= numLines) {
+      ++i;
+      continue;
+    }
+
+    CTextLineList lines;
+
+    addLines(edits[i].line, lines);
+
+    uint line_num2 = line_num1;
+
+    for (++i; i < numEdits; ++i) {
+      uint line_num = edits[i].line_num;
+
+      if (line_num <= line_num2 || line_num >= numLines ||
+          line_num - line_num2 > s_maxSpliceGap + 1)
+        break;
+
+      if (line_num > line_num2 + 1) {
+        CTextLineList gapLines =
+          file_->getLines(uint(int(line_num2) + 1 + shift), line_num - line_num2 - 1);
+
+        lines.insert(lines.end(), gapLines.begin(), gapLines.end());
+      }
+
+      addLines(edits[i].line, lines);
+
+      line_num2 = line_num;
+    }
+
+    uint numOld = line_num2 - line_num1 + 1;
+
+    file_->spliceLines(uint(int(line_num1) + shift), numOld, lines);
+
+    shift += int(lines.size()) - int(numOld);
+
+    lastLine = uint(int(line_num2) + shift);
+  }
+
+  return lastLine;
+}
+
+void
+CTextFileUtil::
+deleteLines(const LineNums &lines)
+{
+  if (lines.empty())
+    return;
+
+  uint numLines = file_->getNumLines();
+
+  uint line_num1 = lines.front();
+  uint line_num2 = std::min(lines.back(), numLines - 1);
+
+  if (line_num1 > line_num2)
+    return;
+
+  // compact lines in range (unmarked lines are shared)
+  CTextLineList oldLines = file_->getLines(line_num1, line_num2 - line_num1 + 1);
+
+  CTextLineList newLines;
+
+  newLines.reserve(oldLines.size());
+
+  auto p = lines.begin();
+
+  for (uint i = line_num1; i <= line_num2; ++i) {
+    while (p != lines.end() && *p < i)
+      ++p;
+
+    if (p != lines.end() && *p == i)
+      continue;
+
+    newLines.push_back(oldLines[i - line_num1]);
+  }
+
+  file_->spliceLines(line_num1, uint(oldLines.size()), newLines);
+}
+
+void
+CTextFileUtil::
+deleteLines(uint line_num1, uint line_num2)
+{
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num1 >= numLines)
+    return;
+
+  line_num2 = std::min(line_num2, numLines - 1);
+
+  file_->spliceLines(line_num1, line_num2 - line_num1 + 1, CTextLineList());
+}
+
+void
+CTextFileUtil::
+duplicateLines(uint line_num1, uint line_num2, bool adjacent, LineNums &lines) const
+{
+  lines.clear();
+
+  uint numLines = file_->getNumLines();
+
+  if (line_num1 > line_num2 || line_num2 >= numLines)
+    return;
+
+  uint n = line_num2 - line_num1 + 1;
+
+  // shared lines (identical pointers are equal without a string compare)
+  CTextLineList lines1 = file_->getLines(line_num1, n);
+
+  auto isEqual = [&](uint i1, uint i2) {
+    return (lines1[i1] == lines1[i2] || lines1[i1]->getString() == lines1[i2]->getString());
+  };
+
+  if (adjacent) {
+    for (uint i = 1; i < n; ++i) {
+      if (isEqual(i - 1, i))
+        lines.push_back(line_num1 + i);
+    }
+
+    return;
+  }
+
+  //---
+
+  // open addressing set of first occurrences of line hashes. A slot stores the high
+  // bits of the 64 bit hash and the line index + 1 (0 for empty) so a line is only
+  // compared with lines of the same hash (8 bytes a slot, at most 3/4 full)
+  struct Slot {
+    uint32_t hash { 0 };
+    uint32_t ind  { 0 };
+  };
+
+  uint numSlots = 16;
+
+  while (numSlots < n + n/3)
+    numSlots *= 2;
+
+  std::vector<Slot> slots(numSlots);
+
+  uint mask = numSlots - 1;
+
+  std::hash<std::string> hasher;
+
+  for (uint i = 0; i < n; ++i) {
+    uint64_t hash = hasher(lines1[i]->getString());
+
+    uint32_t hash1 = uint32_t(hash >> 32);
+
+    // linear probe from low bits
+    uint slot = uint(hash) & mask;
+
+    while (true) {
+      Slot &s = slots[slot];
+
+      if (s.ind == 0) {
+        s.hash = hash1;
+        s.ind  = i + 1;
+        break;
+      }
+
+      if (s.hash == hash1 && isEqual(s.ind - 1, i)) {
+        lines.push_back(line_num1 + i);
+        break;
+      }
+
+      slot = (slot + 1) & mask;
+    }
+  }
+}
+
 void
 CTextFileUtil::
 deleteTo(uint line_num1, uint char_num1, uint line_num2, uint char_num2)
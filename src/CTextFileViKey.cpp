@@ -5,9 +5,20 @@
 #include <CTextFileSel.h>
 #include <CTextFileUtil.h>
 #include <CTextFileUndo.h>
+#include <CTextFileTrigramIndex.h>
 #include <CStrUtil.h>
+#include <algorithm>
 #include <cstring>
 
+namespace {
+
+// lines of ed command output shown in overlay (rest are counted)
+const uint s_maxOutputLines = 1000;
+
+}
+
+//------
+
 CTextFileViKey::
 CTextFileViKey(CTextFile *file) :
  CTextFileKey(file),
@@ -33,6 +44,9 @@ CTextFileViKey(CTextFile *file) :
   ed_->addNotifier(this);
 
   file_->addNotifier(this);
+
+  // vi search patterns are regexps
+  setFindRegExp(true);
 }
 
 CTextFileViKey::
@@ -41,6 +55,7 @@ CTextFileViKey::
   delete marks_;
   delete buffer_;
   delete ed_;
+  delete searchIndex_;
 }
 
 void
@@ -62,6 +77,8 @@ processChar(CKeyType key, const std::string &text, CEventModifier modifier)
     processInsertChar(key, text, modifier);
   else
     processCommandChar(key, text, modifier);
+
+  checkBufferError();
 }
 
 void
@@ -98,19 +115,78 @@ execCmd(const std::string &cmd)
     else {
       std::string status;
 
-      status += std::string("ignorecase ") + CStrUtil::toString(options_.ignorecase) + "\n";
-      status += std::string("list       ") + CStrUtil::toString(options_.list      ) + "\n";
-      status += std::string("number     ") + CStrUtil::toString(options_.number    ) + "\n";
-      status += std::string("showmatch  ") + CStrUtil::toString(options_.showmatch ) + "\n";
-      status += std::string("shiftwidth ") + CStrUtil::toString(options_.shiftwidth) + "\n";
+      status += std::string("ignorecase  ") + CStrUtil::toString(options_.ignorecase ) + "\n";
+      status += std::string("list        ") + CStrUtil::toString(options_.list       ) + "\n";
+      status += std::string("number      ") + CStrUtil::toString(options_.number     ) + "\n";
+      status += std::string("showmatch   ") + CStrUtil::toString(options_.showmatch  ) + "\n";
+      status += std::string("shiftwidth  ") + CStrUtil::toString(options_.shiftwidth ) + "\n";
+      status += std::string("searchindex ") + CStrUtil::toString(options_.searchindex) + "\n";
+      status += std::string("hlsearch    ") + CStrUtil::toString(options_.hlsearch   ) + "\n";
 
       showOverlayMsg(status);
     }
   }
+  else if (cmdName == "earlier") { // earlier [<n>[s|m|h]] - restore checkpoint
+    std::string arg = (num_words > 1 ? words[1] : "");
+
+    uint secs = 0;
+
+    if (! arg.empty()) {
+      char c = arg[arg.size() - 1];
+
+      uint scale = 1;
+
+      if      (c == 's') scale = 1;
+      else if (c == 'm') scale = 60;
+      else if (c == 'h') scale = 3600;
+
+      if (! isdigit(c))
+        arg = arg.substr(0, arg.size() - 1);
+
+      secs = uint(CStrUtil::toInteger(arg))*scale;
+    }
+
+    if (! undo_->restoreEarlier(secs))
+      error("Already at oldest checkpoint");
+  }
+  else if (cmdName == "later") { // later - undo checkpoint restore
+    if (! undo_->restoreLater())
+      error("Already at newest change");
+  }
+  else if (cmdName == "checkpoint") { // checkpoint [<n>] - add or restore checkpoint
+    if (num_words > 1) {
+      uint i = uint(CStrUtil::toInteger(words[1]));
+
+      if (! undo_->restoreCheckpoint(i))
+        error("Invalid checkpoint " + words[1]);
+    }
+    else {
+      uint i = undo_->addCheckpoint();
+
+      showStatusMsg("Checkpoint " + CStrUtil::toString(i));
+    }
+  }
   else {
     ed_->setPos(getPos());
 
+    edOutput_.clear();
+
+    edOutputLines_   = 0;
+    edOutputDropped_ = 0;
+
     ed_->execCmd(cmd);
+
+    // show output of command at once (truncated if long)
+    if (edOutputDropped_ > 0)
+      edOutput_ += "... " + CStrUtil::toString(edOutputDropped_) + " more lines not shown\n";
+
+    if (! edOutput_.empty()) {
+      showOverlayMsg(edOutput_);
+
+      edOutput_.clear();
+    }
+
+    checkBufferError();
   }
 }
 
@@ -153,7 +229,7 @@ processCommandChar(CKeyType key, const std::string &text, CEventModifier modifie
                  key == CKEY_TYPE_KP_Tab) {
           //file_->displayRegisters();
         }
-        else if (isalnum(c) || strchr("#/", c))
+        else if (isalnum(c) || strchr("#/+*", c)) // + and * are shared registers
           register_ = c;
         else
           error("Invalid register name '" + std::string(&c, 1) + "'");
@@ -826,7 +902,8 @@ processNormalChar(CKeyType key, const std::string &, CEventModifier modifier)
       if (util_->getWord(word)) {
         uint fline_num, fchar_num;
 
-        util_->findPrev(word, getRow(), getCol() - 1, 0, 0, &fline_num, &fchar_num);
+        util_->findPrev(word, getRow(), getCol() - 1, 0, 0, &fline_num, &fchar_num,
+                        caseSensitive_);
       }
 
       break;
@@ -839,7 +916,7 @@ processNormalChar(CKeyType key, const std::string &, CEventModifier modifier)
         uint fline_num, fchar_num;
 
         util_->findNext(word, getRow(), getCol() + 1, file_->getNumLines() - 1, -1,
-                        &fline_num, &fchar_num);
+                        &fline_num, &fchar_num, caseSensitive_);
       }
 
       break;
@@ -925,8 +1002,7 @@ processNormalChar(CKeyType key, const std::string &, CEventModifier modifier)
     case CKEY_TYPE_p: {
       file_->startGroup();
 
-      for (uint i = 0; i < std::max(count_, 1U); ++i)
-        buffer_->pasteAfter(register_);
+      buffer_->pasteAfter(register_, std::max(count_, 1U));
 
       file_->endGroup();
 
@@ -938,8 +1014,7 @@ processNormalChar(CKeyType key, const std::string &, CEventModifier modifier)
     case CKEY_TYPE_P: {
       file_->startGroup();
 
-      for (uint i = 0; i < std::max(count_, 1U); ++i)
-        buffer_->pasteBefore(register_);
+      buffer_->pasteBefore(register_, std::max(count_, 1U));
 
       file_->endGroup();
 
@@ -1689,6 +1764,11 @@ setOptionString(const std::string &name, const std::string &arg)
     options_.ignorecase = CStrUtil::toBool(arg1);
 
     ed_->setCaseSensitive(! options_.ignorecase);
+
+    setCaseSensitive(! options_.ignorecase);
+
+    // rematch highlighted pattern
+    notifyFindPattern(findPattern_);
   }
   else if (name1 == "list")
     options_.list = CStrUtil::toBool(arg1);
@@ -1701,6 +1781,22 @@ setOptionString(const std::string &name, const std::string &arg)
     options_.shiftwidth = int(CStrUtil::toInteger(arg1));
   else if (name1 == "showmatch")
     options_.showmatch = CStrUtil::toBool(arg1);
+  else if (name1 == "hlsearch") {
+    options_.hlsearch = CStrUtil::toBool(arg1);
+
+    notifyHlSearch(options_.hlsearch);
+  }
+  else if (name1 == "searchindex") {
+    options_.searchindex = CStrUtil::toBool(arg1);
+
+    if      (options_.searchindex && ! searchIndex_)
+      searchIndex_ = new CTextFileTrigramIndex(file_);
+    else if (! options_.searchindex && searchIndex_) {
+      delete searchIndex_;
+
+      searchIndex_ = nullptr;
+    }
+  }
 }
 
 void
@@ -1785,6 +1881,59 @@ edNotifyQuit(bool)
   notifyQuit();
 }
 
+bool
+CTextFileViKey::
+edNotifyFilterProgress(uint numLines, uint totalLines)
+{
+  return notifyProgress("Filtering lines", numLines, totalLines);
+}
+
+bool
+CTextFileViKey::
+edNotifyOutput(const std::string &text)
+{
+  // keep first lines only, count the rest
+  const char *p1 = text.c_str();
+  const char *p2 = p1 + text.size();
+
+  const char *p = p1;
+
+  while (p < p2 && edOutputLines_ < s_maxOutputLines) {
+    const char *pe = static_cast<const char *>(memchr(p, '\n', size_t(p2 - p)));
+
+    p = (pe ? pe + 1 : p2);
+
+    ++edOutputLines_;
+  }
+
+  edOutput_.append(p1, p);
+
+  edOutputDropped_ += uint(std::count(p, p2, '\n'));
+
+  return true;
+}
+
+bool
+CTextFileViKey::
+edNotifyCount(uint, uint, const std::string &msg)
+{
+  showStatusMsg(msg);
+
+  return true;
+}
+
+void
+CTextFileViKey::
+checkBufferError()
+{
+  if (buffer_->getError().empty())
+    return;
+
+  error(buffer_->getError());
+
+  buffer_->clearError();
+}
+
 void
 CTextFileViKey::
 error(const std::string &msg) const
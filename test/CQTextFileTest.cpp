@@ -10,6 +10,9 @@
 #include <QKeyEvent>
 #include <QStackedWidget>
 #include <QTextEdit>
+#include <QProgressDialog>
+#include <QTimer>
+#include <QApplication>
 
 #include <svg/viMode_svg.h>
 #include <svg/selArea_svg.h>
@@ -120,7 +123,8 @@ showOverlayMsg(const std::string &msg)
     msgWidget_->setChild(msgWidgetText_);
   }
 
-  msgWidgetText_->setText(msg.c_str());
+  // plain text (no rich text detection) set in one operation for large outputs
+  msgWidgetText_->setPlainText(QString::fromUtf8(msg.data(), int(msg.size())));
 
   int w = 300;
   int h = 300;
@@ -146,6 +150,39 @@ notifyQuit()
   exit(0);
 }
 
+bool
+CQTextFileTest::
+notifyProgress(const std::string &msg, uint value, uint maxValue)
+{
+  if (value >= maxValue) {
+    if (progress_)
+      progress_->hide();
+
+    return true;
+  }
+
+  // modal so Escape (or Cancel) cancels operation
+  if (! progress_) {
+    progress_ = new QProgressDialog(this);
+
+    progress_->setWindowModality(Qt::WindowModal);
+    progress_->setMinimumDuration(500);
+    progress_->setAutoClose(false);
+    progress_->setAutoReset(false);
+  }
+
+  if (progress_->isHidden())
+    progress_->reset();
+
+  progress_->setLabelText(msg.c_str());
+  progress_->setRange(0, int(maxValue));
+  progress_->setValue(int(value));
+
+  qApp->processEvents();
+
+  return ! progress_->wasCanceled();
+}
+
 void
 CQTextFileTest::
 resetStatus()
@@ -224,6 +261,14 @@ CQTextFileEdit(CQTextFileTest *test) :
 
   connect(this, SIGNAL(returnPressed()), this, SLOT(processCmd()));
 
+  connect(this, SIGNAL(textEdited(const QString &)), this, SLOT(updateFind(const QString &)));
+
+  incTimer_ = new QTimer(this);
+
+  incTimer_->setInterval(50);
+
+  connect(incTimer_, SIGNAL(timeout()), this, SLOT(incSearchSlot()));
+
   focusOutEvent(0);
 }
 
@@ -239,6 +284,9 @@ startCmd(const std::string &str)
   else if (c == '/') { mode_ = FIND_FORWARD_MODE ; str1 = str1.substr(1); }
   else if (c == '?') { mode_ = FIND_BACKWARD_MODE; str1 = str1.substr(1); }
 
+  if (mode_ != CMD_MODE)
+    file_->getKey()->startIncSearch(mode_ == FIND_FORWARD_MODE);
+
   setFocus();
 
   setText(str1.c_str());
@@ -248,6 +296,10 @@ void
 CQTextFileEdit::
 endCmd()
 {
+  // cancelled find restores position
+  if (file_->getKey()->isIncSearch())
+    file_->getKey()->endIncSearch(false);
+
   setText("");
 
   file_->setFocus();
@@ -265,15 +317,46 @@ processCmd()
     file_->getKey()->execCmd(text().toStdString());
 
     file_->getFile()->endGroup();
+
+    file_->updateDryRun();
+  }
+  else if (mode_ == FIND_FORWARD_MODE) {
+    // keep incremental match, else find from start (no match yet or regexp pattern)
+    if (! file_->getKey()->endIncSearch(true))
+      file_->getKey()->findNext(text().toStdString());
+  }
+  else if (mode_ == FIND_BACKWARD_MODE) {
+    if (! file_->getKey()->endIncSearch(true))
+      file_->getKey()->findPrev(text().toStdString());
   }
-  else if (mode_ == FIND_FORWARD_MODE)
-    file_->getKey()->findNext(text().toStdString());
-  else if (mode_ == FIND_BACKWARD_MODE)
-    file_->getKey()->findPrev(text().toStdString());
 
   endCmd();
 }
 
+void
+CQTextFileEdit::
+updateFind(const QString &text)
+{
+  if (mode_ == CMD_MODE)
+    return;
+
+  file_->getKey()->updateIncSearch(text.toStdString());
+
+  // match not found near start yet so poll for background scan result
+  if (file_->getKey()->isIncSearchPending())
+    incTimer_->start();
+}
+
+void
+CQTextFileEdit::
+incSearchSlot()
+{
+  file_->getKey()->pollIncSearch();
+
+  if (! file_->getKey()->isIncSearchPending())
+    incTimer_->stop();
+}
+
 void
 CQTextFileEdit::
 focusInEvent(QFocusEvent *e)
@@ -11,6 +11,8 @@ class QHBoxLayout;
 class QLabel;
 class QTextEdit;
 class QStackedWidget;
+class QProgressDialog;
+class QTimer;
 
 class CTextFileEd;
 
@@ -139,8 +141,13 @@ class CQTextFileEdit : public QLineEdit, public CQTextFileControl {
  private slots:
   void processCmd();
 
+  void updateFind(const QString &text);
+
+  void incSearchSlot();
+
  private:
-  Mode mode_;
+  Mode    mode_;
+  QTimer *incTimer_ { nullptr }; // polls pending incremental search match
 };
 
 class CQTextFileTest : public QWidget, public CTextFileKeyNotifier {
@@ -161,6 +168,8 @@ class CQTextFileTest : public QWidget, public CTextFileKeyNotifier {
 
   void notifyQuit();
 
+  bool notifyProgress(const std::string &msg, uint value, uint maxValue);
+
   void resetStatus();
 
   QSize sizeHint() const { return QSize(600,800); }
@@ -180,4 +189,5 @@ class CQTextFileTest : public QWidget, public CTextFileKeyNotifier {
   CQTextFileNumMode   *numMode_ { nullptr };
   CQWinWidget         *msgWidget_ { nullptr };
   QTextEdit           *msgWidgetText_ { nullptr };
+  QProgressDialog     *progress_ { nullptr };
 };
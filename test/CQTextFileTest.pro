@@ -61,4 +61,4 @@ unix:LIBS += \
 -L../../CRegExp/lib \
 -lCQTextFile -lCQUtil -lCCommand -lCImageLib -lCConfig -lCUndo -lCFont -lCReadLine -lCFile \
 -lCFileUtil -lCMath -lCStrUtil -lCRGBName -lCUtil -lCOS -lCRegExp \
--ljpeg -lpng -lcurses -ltre
+-ljpeg -lpng -lcurses -ltre -lrt
@@ -0,0 +1,388 @@
+#include <CTextFileEdBatch.h>
+#include <CTextFile.h>
+#include <CTextFileEd.h>
+#include <CTextFileSearch.h>
+#include <CFile.h>
+#include <CStrUtil.h>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// ed collecting output and errors for the file being processed
+class CTextFileEdBatchEd : public CTextFileEd {
+ public:
+  CTextFileEdBatchEd(CTextFile *file, std::string &msgs) :
+   CTextFileEd(file), msgs_(msgs) {
+  }
+
+  void outputLines(const std::string &text) override { msgs_ += text; }
+
+  void error(const std::string &msg) override { msgs_ += "Error: " + msg + "\n"; }
+
+ private:
+  std::string &msgs_;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed(const Clock::time_point &t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+bool sameLines(const CTextLineList &lines1, const CTextLineList &lines2) {
+  if (lines1.size() != lines2.size())
+    return false;
+
+  uint numLines = uint(lines1.size());
+
+  // unchanged lines are shared
+  for (uint i = 0; i < numLines; ++i) {
+    if (lines1[i] != lines2[i] && lines1[i]->getString() != lines2[i]->getString())
+      return false;
+  }
+
+  return true;
+}
+
+void usage() {
+  std::cerr << "Usage: CTextFileEdBatch [-j <n>] [-n] [-v] [-x] [-i] [-l <list>] "
+               "<script> [<file> ...]\n";
+  std::cerr << "  -j <n>    : number of worker threads (default: all cores)\n";
+  std::cerr << "  -n        : dry run (don't write changed files)\n";
+  std::cerr << "  -v        : report each file and its time\n";
+  std::cerr << "  -x        : ex mode\n";
+  std::cerr << "  -i        : case insensitive patterns\n";
+  std::cerr << "  -l <list> : read file names from file (one per line)\n";
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  CTextFileEdBatch batch;
+
+  std::string              scriptName;
+  std::vector<std::string> lists;
+
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      std::string arg = &argv[i][1];
+
+      if      (arg == "j" && i < argc - 1)
+        batch.setNumThreads(uint(std::max(0L, CStrUtil::toInteger(argv[++i]))));
+      else if (arg == "n")
+        batch.setDryRun(true);
+      else if (arg == "v")
+        batch.setVerbose(true);
+      else if (arg == "x")
+        batch.setEx(true);
+      else if (arg == "i")
+        batch.setCaseSensitive(false);
+      else if (arg == "l" && i < argc - 1)
+        lists.push_back(argv[++i]);
+      else if (arg == "h") {
+        usage();
+        return 0;
+      }
+      else {
+        std::cerr << "Invalid option '" << argv[i] << "'\n";
+        usage();
+        return 1;
+      }
+    }
+    else if (scriptName == "")
+      scriptName = argv[i];
+    else
+      batch.addFile(argv[i]);
+  }
+
+  if (scriptName == "") {
+    usage();
+    return 1;
+  }
+
+  if (! batch.setScript(scriptName))
+    return 1;
+
+  for (const auto &list : lists) {
+    if (! batch.addFileList(list)) {
+      std::cerr << "Invalid file list '" << list << "'\n";
+      return 1;
+    }
+  }
+
+  return (batch.exec() ? 0 : 1);
+}
+
+//------
+
+CTextFileEdBatch::
+CTextFileEdBatch()
+{
+}
+
+bool
+CTextFileEdBatch::
+setScript(const std::string &fileName)
+{
+  script_ = CTextFileEdScript(caseSensitive_);
+
+  script_.setEx(ex_);
+
+  if (! script_.compileFile(fileName)) {
+    std::cerr << fileName << ": " << script_.getError() << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+void
+CTextFileEdBatch::
+addFile(const std::string &fileName)
+{
+  fileNames_.push_back(fileName);
+}
+
+bool
+CTextFileEdBatch::
+addFileList(const std::string &fileName)
+{
+  CFile file(fileName);
+
+  if (! file.exists() || ! file.isRegular())
+    return false;
+
+  std::vector<std::string> lines;
+
+  file.toLines(lines);
+
+  for (const auto &line : lines) {
+    std::string line1 = CStrUtil::stripSpaces(line);
+
+    if (! line1.empty())
+      addFile(line1);
+  }
+
+  return true;
+}
+
+bool
+CTextFileEdBatch::
+exec()
+{
+  uint numFiles = uint(fileNames_.size());
+
+  uint numThreads = numThreads_;
+
+  if (numThreads == 0)
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+
+  numThreads = std::max(1U, std::min(numThreads, numFiles));
+
+  // files are processed in parallel so don't also split each file
+  if (numThreads > 1)
+    CTextFileSearch::setNumThreads(1);
+
+  fileInd_    = 0;
+  numChanged_ = 0;
+  numFailed_  = 0;
+  numLines_   = 0;
+
+  Clock::time_point t = Clock::now();
+
+  std::vector<std::thread> threads;
+
+  for (uint i = 1; i < numThreads; ++i)
+    threads.push_back(std::thread([this]() { runWorker(); }));
+
+  runWorker();
+
+  for (auto &thread : threads)
+    thread.join();
+
+  double time = elapsed(t);
+
+  //---
+
+  double rtime = std::max(time, 1E-6);
+
+  std::cout << CStrUtil::strprintf(
+    "%u files (%u changed, %u failed), %lu lines in %.3fs "
+    "(%.0f files/s, %.0f lines/s, %u threads)\n",
+    numFiles, numChanged_, numFailed_, (unsigned long) numLines_, time,
+    numFiles/rtime, double(numLines_)/rtime, numThreads);
+
+  return (numFailed_ == 0);
+}
+
+void
+CTextFileEdBatch::
+runWorker()
+{
+  // compiled patterns store their last match so each worker has its own copy
+  CTextFileEdScript script(script_);
+
+  uint numFiles = uint(fileNames_.size());
+
+  while (true) {
+    uint i = fileInd_++;
+
+    if (i >= numFiles)
+      break;
+
+    Result result;
+
+    processFile(script, fileNames_[i], result);
+
+    addResult(fileNames_[i], result);
+  }
+}
+
+void
+CTextFileEdBatch::
+processFile(CTextFileEdScript &script, const std::string &fileName, Result &result)
+{
+  Clock::time_point t = Clock::now();
+
+  CTextFile file;
+
+  if (! file.read(fileName.c_str())) {
+    result.ok   = false;
+    result.msgs = "Error: Failed to read file\n";
+    return;
+  }
+
+  // lines are shared until changed so snapshot is cheap
+  CTextFileSnapshot snapshot = file.getSnapshot();
+
+  {
+    CTextFileEdBatchEd ed(&file, result.msgs);
+
+    ed.setEx(ex_);
+    ed.setCaseSensitive(caseSensitive_);
+
+    ed.init();
+
+    CTextFileNoUndo noUndo(&file);
+
+    result.ok = script.exec(&ed);
+  }
+
+  result.numLines = file.getNumLines();
+  result.changed  = ! sameLines(snapshot.lines, file.getSnapshot().lines);
+
+  if (result.changed && ! dryRun_) {
+    std::string msg;
+
+    if (! writeFile(file, fileName, msg)) {
+      result.ok    = false;
+      result.msgs += "Error: " + msg + "\n";
+    }
+  }
+
+  result.time = elapsed(t);
+}
+
+bool
+CTextFileEdBatch::
+writeFile(const CTextFile &file, const std::string &fileName, std::string &msg)
+{
+  // write temporary file in same directory (same file system) and rename over original.
+  // The name is unique (mkstemp) as workers of this process may write files at once
+  std::string tmpName = fileName + ".edbatch.XXXXXX";
+
+  int fd = mkstemp(&tmpName[0]);
+
+  if (fd < 0) {
+    msg = "Failed to create '" + tmpName + "': " + strerror(errno);
+
+    return false;
+  }
+
+  FILE *fp = fdopen(fd, "w");
+
+  if (! fp) {
+    close(fd);
+
+    unlink(tmpName.c_str());
+
+    msg = "Failed to open '" + tmpName + "': " + strerror(errno);
+
+    return false;
+  }
+
+  bool ok = true;
+
+  uint numLines = file.getNumLines();
+
+  for (uint i = 0; i < numLines && ok; ++i) {
+    const std::string &line = file.getLine(i);
+
+    ok = (fwrite(line.data(), 1, line.size(), fp) == line.size() && fputc('\n', fp) != EOF);
+  }
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (! ok) {
+    unlink(tmpName.c_str());
+
+    msg = "Failed to write '" + tmpName + "'";
+
+    return false;
+  }
+
+  struct stat st;
+
+  if (stat(fileName.c_str(), &st) == 0)
+    chmod(tmpName.c_str(), st.st_mode & 07777);
+
+  if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+    unlink(tmpName.c_str());
+
+    msg = "Failed to rename '" + tmpName + "': " + strerror(errno);
+
+    return false;
+  }
+
+  return true;
+}
+
+void
+CTextFileEdBatch::
+addResult(const std::string &fileName, const Result &result)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (result.changed)
+    ++numChanged_;
+
+  if (! result.ok)
+    ++numFailed_;
+
+  numLines_ += result.numLines;
+
+  if (verbose_)
+    std::cout << CStrUtil::strprintf("%s: %u lines%s%s, %.3fms\n", fileName.c_str(),
+                                     result.numLines, result.changed ? ", changed" : "",
+                                     result.ok ? "" : ", failed", 1000.0*result.time);
+
+  if (! result.msgs.empty()) {
+    std::vector<std::string> lines;
+
+    CStrUtil::addLines(result.msgs, lines);
+
+    for (const auto &line : lines)
+      std::cout << fileName << ": " << line << "\n";
+  }
+}
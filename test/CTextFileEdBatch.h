@@ -0,0 +1,84 @@
+#include <CTextFileEdScript.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CTextFile;
+
+// Headless batch run of an ed script on many files.
+//
+// The script is compiled once and each worker thread runs its own copy of it with its
+// own CTextFile and CTextFileEd, taking the next file from a shared index. Edits are
+// not recorded for undo, and a changed file is written to a temporary file in the same
+// directory which is then renamed over the original.
+class CTextFileEdBatch {
+ public:
+  typedef std::vector<std::string> FileNames;
+
+ public:
+  CTextFileEdBatch();
+
+  // number of worker threads (0 for hardware concurrency)
+  uint getNumThreads() const { return numThreads_; }
+  void setNumThreads(uint n) { numThreads_ = n; }
+
+  // run script but don't write changed files
+  bool isDryRun() const { return dryRun_; }
+  void setDryRun(bool b) { dryRun_ = b; }
+
+  // report each file (and its time)
+  bool isVerbose() const { return verbose_; }
+  void setVerbose(bool b) { verbose_ = b; }
+
+  bool getEx() const { return ex_; }
+  void setEx(bool ex) { ex_ = ex; }
+
+  bool isCaseSensitive() const { return caseSensitive_; }
+  void setCaseSensitive(bool b) { caseSensitive_ = b; }
+
+  // compile script file
+  bool setScript(const std::string &fileName);
+
+  void addFile(const std::string &fileName);
+
+  // add files named in file (one per line)
+  bool addFileList(const std::string &fileName);
+
+  const FileNames &getFiles() const { return fileNames_; }
+
+  // run script on all files (false if any file failed)
+  bool exec();
+
+ private:
+  struct Result {
+    bool        ok       { true };
+    bool        changed  { false };
+    uint        numLines { 0 };
+    double      time     { 0.0 }; // seconds
+    std::string msgs;
+  };
+
+  void runWorker();
+
+  void processFile(CTextFileEdScript &script, const std::string &fileName, Result &result);
+
+  bool writeFile(const CTextFile &file, const std::string &fileName, std::string &msg);
+
+  void addResult(const std::string &fileName, const Result &result);
+
+ private:
+  CTextFileEdScript script_;
+  FileNames         fileNames_;
+  uint              numThreads_    { 0 };
+  bool              dryRun_        { false };
+  bool              verbose_       { false };
+  bool              ex_            { false };
+  bool              caseSensitive_ { true };
+  std::atomic<uint> fileInd_       { 0 };
+  std::mutex        mutex_;        // output and totals
+  uint              numChanged_    { 0 };
+  uint              numFailed_     { 0 };
+  uint64_t          numLines_      { 0 };
+};
@@ -0,0 +1,64 @@
+TEMPLATE = app
+
+QT -= core gui
+
+CONFIG += console
+
+TARGET = CTextFileEdBatch
+
+DEPENDPATH += .
+
+QMAKE_CXXFLAGS += -std=c++17
+
+CONFIG += debug
+
+# Input (core classes only, no Qt)
+SOURCES += \
+CTextFileEdBatch.cpp \
+../src/CTextFile.cpp \
+../src/CTextFileBuffer.cpp \
+../src/CTextFileDryRun.cpp \
+../src/CTextFileEd.cpp \
+../src/CTextFileEdScript.cpp \
+../src/CTextFileFilter.cpp \
+../src/CTextFileGlobMarks.cpp \
+../src/CTextFileLineRegExp.cpp \
+../src/CTextFileMarks.cpp \
+../src/CTextFileRegExpCache.cpp \
+../src/CTextFileSearch.cpp \
+../src/CTextFileSharedBuffer.cpp \
+../src/CTextFileSort.cpp \
+../src/CTextFileStrSearch.cpp \
+../src/CTextFileSubst.cpp \
+../src/CTextFileTrigramIndex.cpp \
+../src/CTextFileUndo.cpp \
+../src/CTextFileUtil.cpp \
+
+HEADERS += \
+CTextFileEdBatch.h \
+
+DESTDIR     = ../bin
+OBJECTS_DIR = ../obj/batch
+
+INCLUDEPATH += \
+. \
+../include \
+../../CCommand/include \
+../../CUndo/include \
+../../CFile/include \
+../../COS/include \
+../../CStrUtil/include \
+../../CUtil/include \
+../../CMath/include \
+../../CRegExp/include \
+
+unix:LIBS += \
+-L../../CCommand/lib \
+-L../../CUndo/lib \
+-L../../CFile/lib \
+-L../../CStrUtil/lib \
+-L../../CUtil/lib \
+-L../../COS/lib \
+-L../../CRegExp/lib \
+-lCCommand -lCUndo -lCFile -lCStrUtil -lCUtil -lCOS -lCRegExp \
+-ltre -lpthread -lrt
@@ -0,0 +1,277 @@
+#include <CTextFileStrSearch.h>
+#include <CStrUtil.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Benchmark of the literal search kernel (CTextFileStrSearch) against the previous
+// CStrUtil::strstr/strrstr search, finding all matches in each line of a generated
+// (or loaded) text. Both must find the same matches.
+
+namespace {
+
+typedef std::vector<std::string> Lines;
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed(const Clock::time_point &t) {
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+// random lines of words with pattern added every hitLines lines
+void makeLines(uint numLines, uint lineLen, uint hitLines, const std::string &pattern,
+               Lines &lines) {
+  static const char *chars = "abcdefghijklmnopqrstuvwxyz      ";
+
+  lines.resize(numLines);
+
+  for (uint i = 0; i < numLines; ++i) {
+    std::string &line = lines[i];
+
+    line.resize(lineLen);
+
+    for (uint j = 0; j < lineLen; ++j)
+      line[j] = chars[rand() % 32];
+
+    if (hitLines > 0 && i % hitLines == 0 && pattern.size() <= lineLen)
+      line.replace(rand() % (lineLen - pattern.size() + 1), pattern.size(), pattern);
+  }
+}
+
+bool loadLines(const std::string &fileName, Lines &lines) {
+  std::ifstream is(fileName);
+
+  if (! is)
+    return false;
+
+  std::string line;
+
+  while (std::getline(is, line))
+    lines.push_back(line);
+
+  return true;
+}
+
+// number of (non-overlapping) matches in all lines searching forward or backward
+uint strstrCount(const Lines &lines, const std::string &pattern, bool forward) {
+  uint n    = 0;
+  uint plen = uint(pattern.size());
+
+  for (const auto &line : lines) {
+    uint len = uint(line.size());
+
+    if (len < plen)
+      continue;
+
+    const char *cline = line.c_str();
+
+    if (forward) {
+      uint pos = 0;
+
+      while (pos + plen <= len) {
+        char *p = CStrUtil::strstr(&cline[pos], &cline[len - 1], pattern.c_str());
+
+        if (! p)
+          break;
+
+        ++n;
+
+        pos = uint(p - cline) + plen;
+      }
+    }
+    else {
+      // last char of range to search
+      int pos = int(len) - 1;
+
+      while (pos >= int(plen) - 1) {
+        char *p = CStrUtil::strrstr(&cline[pos], cline, pattern.c_str());
+
+        if (! p)
+          break;
+
+        ++n;
+
+        pos = int(p - cline) - 1;
+      }
+    }
+  }
+
+  return n;
+}
+
+uint kernelCount(const Lines &lines, const std::string &pattern, bool forward,
+                 bool caseSensitive) {
+  uint n    = 0;
+  uint plen = uint(pattern.size());
+
+  for (const auto &line : lines) {
+    uint len = uint(line.size());
+
+    if (len < plen)
+      continue;
+
+    const char *cline = line.c_str();
+
+    if (forward) {
+      uint pos = 0;
+
+      while (pos + plen <= len) {
+        int p = CTextFileStrSearch::findNext(&cline[pos], len - pos, pattern.c_str(), plen,
+                                             caseSensitive);
+
+        if (p < 0)
+          break;
+
+        ++n;
+
+        pos += uint(p) + plen;
+      }
+    }
+    else {
+      uint end = len;
+
+      while (end >= plen) {
+        int p = CTextFileStrSearch::findPrev(cline, end, pattern.c_str(), plen,
+                                             caseSensitive);
+
+        if (p < 0)
+          break;
+
+        ++n;
+
+        end = uint(p);
+      }
+    }
+  }
+
+  return n;
+}
+
+void usage() {
+  std::cerr << "Usage: CTextFileStrSearchBench [-n <lines>] [-l <length>] [-m <lines>] "
+               "[-r <repeats>] [-f <file>] [<pattern>]\n";
+  std::cerr << "  -n <lines>   : number of generated lines (default: 1000000)\n";
+  std::cerr << "  -l <length>  : length of generated lines (default: 100)\n";
+  std::cerr << "  -m <lines>   : add pattern to every <lines> lines (default: 1000)\n";
+  std::cerr << "  -r <repeats> : number of timed runs (best is reported, default: 5)\n";
+  std::cerr << "  -f <file>    : search lines of file instead\n";
+  std::cerr << "  <pattern>    : pattern (default: needle)\n";
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  uint        numLines = 1000000;
+  uint        lineLen  = 100;
+  uint        hitLines = 1000;
+  uint        repeats  = 5;
+  std::string fileName;
+  std::string pattern  = "needle";
+
+  auto toUInt = [](const char *str) {
+    return uint(std::max(0L, CStrUtil::toInteger(str)));
+  };
+
+  for (int i = 1; i < argc; ++i) {
+    if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      std::string arg = &argv[i][1];
+
+      if      (arg == "n" && i < argc - 1)
+        numLines = toUInt(argv[++i]);
+      else if (arg == "l" && i < argc - 1)
+        lineLen = toUInt(argv[++i]);
+      else if (arg == "m" && i < argc - 1)
+        hitLines = toUInt(argv[++i]);
+      else if (arg == "r" && i < argc - 1)
+        repeats = std::max(toUInt(argv[++i]), 1U);
+      else if (arg == "f" && i < argc - 1)
+        fileName = argv[++i];
+      else if (arg == "h") {
+        usage();
+        return 0;
+      }
+      else {
+        std::cerr << "Invalid option '" << argv[i] << "'\n";
+        usage();
+        return 1;
+      }
+    }
+    else
+      pattern = argv[i];
+  }
+
+  if (pattern.empty()) {
+    usage();
+    return 1;
+  }
+
+  Lines lines;
+
+  if (fileName != "") {
+    if (! loadLines(fileName, lines)) {
+      std::cerr << "Failed to read '" << fileName << "'\n";
+      return 1;
+    }
+  }
+  else
+    makeLines(numLines, lineLen, hitLines, pattern, lines);
+
+  double size = 0.0;
+
+  for (const auto &line : lines)
+    size += double(line.size());
+
+  printf("%u lines, %.1f MB, pattern '%s'\n", uint(lines.size()), size/1e6, pattern.c_str());
+
+  // best of repeats
+  bool ok = true;
+
+  auto run = [&](const char *name, const std::function<uint()> &proc, uint expected) {
+    double best = 0.0;
+    uint   n    = 0;
+
+    for (uint i = 0; i < repeats; ++i) {
+      Clock::time_point t = Clock::now();
+
+      n = proc();
+
+      double time = elapsed(t);
+
+      if (i == 0 || time < best)
+        best = time;
+    }
+
+    printf("%-28s %8.4fs %9.1f MB/s %8u matches\n", name, best, size/best/1e6, n);
+
+    if (expected != uint(-1) && n != expected) {
+      printf("  expected %u matches\n", expected);
+      ok = false;
+    }
+
+    return n;
+  };
+
+  uint n1 = run("CStrUtil::strstr", [&]() {
+    return strstrCount(lines, pattern, true); }, uint(-1));
+  run("CTextFileStrSearch::findNext", [&]() {
+    return kernelCount(lines, pattern, true, true); }, n1);
+
+  uint n2 = run("CStrUtil::strrstr", [&]() {
+    return strstrCount(lines, pattern, false); }, uint(-1));
+  run("CTextFileStrSearch::findPrev", [&]() {
+    return kernelCount(lines, pattern, false, true); }, n2);
+
+  // no previous path for case insensitive search
+  run("findNext (no case)", [&]() {
+    return kernelCount(lines, pattern, true, false); }, uint(-1));
+
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,30 @@
+TEMPLATE = app
+
+QT -= core gui
+
+CONFIG += console
+
+TARGET = CTextFileStrSearchBench
+
+DEPENDPATH += .
+
+QMAKE_CXXFLAGS += -std=c++17 -O2
+
+CONFIG += release
+
+# Input (literal search kernel only, no Qt)
+SOURCES += \
+CTextFileStrSearchBench.cpp \
+../src/CTextFileStrSearch.cpp \
+
+DESTDIR     = ../bin
+OBJECTS_DIR = ../obj/bench
+
+INCLUDEPATH += \
+. \
+../include \
+../../CStrUtil/include \
+
+unix:LIBS += \
+-L../../CStrUtil/lib \
+-lCStrUtil